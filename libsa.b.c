@@ -0,0 +1,248 @@
+#include "libsa.h"
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/* The benchmark of libsa.
+   Each input family is generated and built in a child process, which makes
+   the peak rss of a child the peak rss of the build of one family.  */
+
+static void*
+alloc (size_t size)
+{
+    void *r = malloc (size);
+    assert (size == 0 || r);
+    return r;
+}
+
+/* Return the time in seconds.  */
+static double
+now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Uniformly random bytes.  */
+static void
+gen_random (char *input, size_t len)
+{
+    size_t k;
+
+    for (k = 0; k < len; ++k)
+      input[k] = 1 + rand () % 255;
+}
+
+/* A low entropy DNA-like string of 4 characters, which repeats earlier
+   fragments of itself with occasional mutations.  */
+static void
+gen_dna (char *input, size_t len)
+{
+    const char acgt[] = "acgt";
+    size_t k;
+
+    for (k = 0; k < len; ++k)
+      if (k > 1000 && rand () % 4 == 0)
+        {
+          /* Copy a fragment of up to 1000 characters from the past.  */
+          size_t src = rand () % (k - 1000);
+          size_t n = 1 + rand () % 1000;
+          for (; n > 0 && k < len; --n, ++k, ++src)
+            input[k] = rand () % 100 ? input[src] : acgt[rand () % 4];
+          --k;
+        }
+      else
+        input[k] = acgt[rand () % 4];
+}
+
+/* The Fibonacci string, which causes the deepest recursion.  */
+static void
+gen_fibonacci (char *input, size_t len)
+{
+    size_t k, n;
+
+    /* The fibonacci string is the fixed point of a -> ab, b -> a.
+       The string is generated in place from its own prefix.  */
+    input[0] = 'a';
+    for (k = 0, n = 1; n < len; ++k)
+      {
+        input[n++] = 'a';
+        if (input[k] == 'a' && n < len)
+          input[n++] = 'b';
+      }
+}
+
+/* A periodic string with a period of 7.  */
+static void
+gen_periodic (char *input, size_t len)
+{
+    size_t k;
+
+    for (k = 0; k < len; ++k)
+      input[k] = "abacaba"[k % 7];
+}
+
+/* Natural text-like words separated by spaces and punctuation.
+   The frequency of a word is roughly inversely proportional to its rank.  */
+static void
+gen_text (char *input, size_t len)
+{
+    enum {nwords = 4096};
+    static char words[nwords][12];
+    size_t k, w;
+
+    for (w = 0; w < nwords; ++w)
+      {
+        const size_t n = 1 + rand () % 10;
+        for (k = 0; k < n; ++k)
+          words[w][k] = 'a' + rand () % 26;
+        words[w][n] = '\0';
+      }
+    for (k = 0; k < len;)
+      {
+        const char *p;
+
+        /* The square of a uniform value favors small ranks.  */
+        w = (size_t) rand () % nwords;
+        w = w * w / nwords;
+        for (p = words[w]; *p && k < len; ++p)
+          input[k++] = *p;
+        if (k < len)
+          input[k++] = rand () % 16 ? ' ' : rand () % 2 ? '.' : '\n';
+      }
+}
+
+struct family
+{
+    const char *name;
+    void (*gen) (char *input, size_t len);
+};
+
+static const struct family families[] =
+{
+    {"random", gen_random},
+    {"dna", gen_dna},
+    {"fibonacci", gen_fibonacci},
+    {"periodic", gen_periodic},
+    {"text", gen_text},
+    {0, 0}
+};
+
+/* Generate an input of family f and build its suffix array and lcp array on
+   nthreads threads.  Print the speed of each build, the recursion depth and
+   the peak rss.
+   Return 0 on success.  */
+static int
+run (const struct family *f, size_t len, int nthreads)
+{
+    char *input;
+    int *sa, *lcp;
+    struct libsa_ctx *ctx;
+    struct rusage ru;
+    double t, tsa, tlcp, tsalcp;
+    int depth, rc;
+    const double mb = len / 1e6;
+
+    input = alloc (len);
+    sa = alloc (len * sizeof *sa);
+    lcp = alloc (len * sizeof *lcp);
+    f->gen (input, len - 1);
+    input[len-1] = '\0';
+
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_threads (ctx, nthreads);
+    t = now ();
+    rc = libsa_ctx_build (ctx, sa, input, len);
+    tsa = now () - t;
+    depth = libsa_ctx_stats (ctx)->depth;
+    t = now ();
+    rc |= libsa_ctx_build_lcp (ctx, lcp, sa, input, len);
+    tlcp = now () - t;
+    t = now ();
+    rc |= libsa_ctx_build_sa_lcp (ctx, sa, lcp, input, len);
+    tsalcp = now () - t;
+    libsa_ctx_destroy (ctx);
+
+    getrusage (RUSAGE_SELF, &ru);
+    printf ("%-10s %10.2f %10.2f %10.2f %6d %10ld\n", f->name, mb / tsa,
+            mb / tlcp, mb / tsalcp, depth, ru.ru_maxrss);
+    fflush (stdout);
+    free (lcp);
+    free (sa);
+    free (input);
+    return rc;
+}
+
+int main (int argc, char *argv[])
+{
+    const struct family *f;
+    size_t len = 1 << 24;
+    int nthreads = 1, status = 0;
+    char *r;
+    const char help[] = "usage: %s [length=16777216] [nthreads=1]\n";
+
+    if (argc > 1)
+      {
+        errno = 0;
+        len = strtoul (argv[1], &r, 0);
+        if (errno || r == argv[1] || len < 2)
+          {
+            fprintf (stderr, help, argv[0]);
+            return 1;
+          }
+      }
+    if (argc > 2)
+      {
+        errno = 0;
+        nthreads = strtol (argv[2], &r, 0);
+        if (errno || r == argv[2])
+          {
+            fprintf (stderr, help, argv[0]);
+            return 1;
+          }
+      }
+
+    printf ("len = %zu, nthreads = %d\n", len, nthreads);
+    printf ("%-10s %10s %10s %10s %6s %10s\n", "input", "sa MB/s", "lcp MB/s",
+            "salcp MB/s", "depth", "rss KB");
+    fflush (stdout);
+    for (f = families; f->name; ++f)
+      {
+        pid_t pid = fork ();
+        int ws;
+
+        if (pid < 0)
+          {
+            perror ("fork");
+            return 1;
+          }
+        if (pid == 0)
+          {
+            srand (1);
+            exit (run (f, len, nthreads));
+          }
+        if (waitpid (pid, &ws, 0) < 0 || !WIFEXITED (ws) || WEXITSTATUS (ws))
+          {
+            fprintf (stderr, "%s failed\n", f->name);
+            status = 1;
+          }
+      }
+    return status;
+}
+
+/* Copyright (c) 2025 Dmitry Goncharov
+ * dgoncharov@users.sf.net.
+ *
+ * Distributed under GPL v2 or the BSD License (see accompanying file copying),
+ * your choice.
+ */
@@ -4,29 +4,18 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* This implementation uses term "lms block" to mean what the paper calls "lms
    substring".  Because word "block" is shorter than "substring".  */
 
-/* nrecursion is a only used to print the depth of recursion for debugging
-   purposes.  */
-static int nrecursion;
-static int verbose;
-
-/* Forward all arguments to printf.
-   The only reason this function is used instead of printf is its ability to
-   avoid printing anything when logging is disabled.  */
-static void
-print (const char *f, ...)
-{
-    va_list ap;
-    if (!verbose)
-      return;
-    va_start (ap, f);
-    vprintf (f, ap);
-    va_end (ap);
-}
-
 /* malloc and assert that malloc succeeded.  */
 static void*
 alloc (size_t size)
@@ -36,605 +25,1125 @@ alloc (size_t size)
     return r;
 }
 
-/* Allocate a copy of 'b' of 'len' elements.  */
-static int*
-alloc_copy (const int *b, size_t len)
+/* A workspace is a buffer from which build carves all of its scratch arrays.
+   The arrays are released in the reverse order of their allocation.  */
+struct workspace
+{
+    char *buf;
+    size_t size;
+    size_t used;
+    /* The largest value of used since the workspace was init.  */
+    size_t peak;
+};
+
+enum {ws_alignment = 16};
+
+/* Round size up to the alignment of the arrays allocated from a workspace.  */
+static size_t
+ws_round (size_t size)
 {
-    int *r = alloc (len * sizeof *r);
-    return memcpy (r, b, len * sizeof *r);
+    return (size + ws_alignment - 1) / ws_alignment * ws_alignment;
 }
 
-/* Allocate an array of int of 'len' elements and memset it with 'value'.  */
-static int*
-alloc_init (int value, size_t len)
+/* Init ws to allocate from the size bytes of buf.  */
+static void
+ws_init (struct workspace *ws, void *buf, size_t size)
 {
-    int *r = alloc (len * sizeof *r);
-    return memset (r, value, len * sizeof *r);
+    ws->buf = buf;
+    ws->size = size;
+    ws->used = 0;
+    ws->peak = 0;
 }
 
-/* Print len elements of input either as character or integers.  */
+/* Allocate size bytes from ws and assert that ws is large enough.  */
+static void*
+ws_alloc (struct workspace *ws, size_t size)
+{
+    void *r = ws->buf + ws->used;
+    ws->used += ws_round (size);
+    assert (ws->used <= ws->size);
+    if (ws->used > ws->peak)
+      ws->peak = ws->used;
+    return r;
+}
+
+/* Release p and every array allocated from ws after p.  */
 static void
-print_array (const int *input, size_t len, int ascii, int depth)
+ws_free (struct workspace *ws, void *p)
 {
-    size_t k;
+    assert ((char *) p >= ws->buf && (char *) p <= ws->buf + ws->used);
+    ws->used = (char *) p - ws->buf;
+}
 
-    if (!verbose)
-      return;
+/* The number of elements of result that induce_l_par and induce_s_par process
+   at a time.
+   Inputs of this size or smaller are always processed on one thread, both by
+   build and by libsa_ctx_build_lcp.  */
+enum {induce_block = 1 << 16};
 
-    print ("%*s", depth, "");
-    for (k = 0; k < len; ++k)
-      if (ascii && input[k] > 31 && input[k] < 127)
-        print (" %c ", (char) input[k]);
-      else
-        print (" %d ", input[k]);
-    print ("\n");
+/* The largest alphabet whose characters classify_par counts on every
+   thread.  */
+enum {classify_abclen = UCHAR_MAX + 1};
+
+/* The largest alphabet that a build never compacts.  */
+enum {compact_abclen = UCHAR_MAX + 1};
+
+/* The number of elements ahead of the current one of result whose input
+   and type induce_l and induce_s prefetch.  */
+enum {prefetch_distance = 32};
+
+/* The type of each position of the input of a build is one bit of a bitset,
+   1 for L and 0 for S.  The bitset takes len / 8 bytes, rather than an int
+   for each position.  */
+enum {type_bits = 64};
+
+/* Return the number of words of the bitset of the types of len positions.  */
+static size_t
+type_words (size_t len)
+{
+    return (len + type_bits - 1) / type_bits;
 }
 
-/* Pretty print a table that contains input, type, lms, suffix array and buckets
-   along with the index of each element.  */
+/* Return 1 if position k is L type and 0 if k is S type.  */
+static int
+ltype (const uint64_t *type, size_t k)
+{
+    return type[k / type_bits] >> k % type_bits & 1;
+}
+
+/* Make position k L type.  */
 static void
-print_sa (const int *result, const int *input, const int *type, const int *buckets,
-       size_t len, size_t abclen, int depth)
+set_ltype (uint64_t *type, size_t k)
 {
-    size_t k;
-    int *b;
-    const int ascii = depth == 0;
+    type[k / type_bits] |= (uint64_t) 1 << k % type_bits;
+}
 
-    if (!verbose)
-      return;
+/* Return 1 if position k is lms, which is an S position preceded by an L
+   position.  */
+static int
+is_lms (const uint64_t *type, size_t k)
+{
+    return k > 0 && !ltype (type, k) && ltype (type, k - 1);
+}
 
-    b = alloc_copy (buckets, abclen);
-    print ("\n%*sindex  ", depth, "");
-    for (k = 0; k < len; ++k)
-      print ("%2lu ", k);
-    print ("\n%*sinput  ", depth, "");
-    print_array (input, len, depth == 0, 0);
-    print ("%*stype   ", depth, "");
-    for (k = 0; k < len; ++k)
-      if (type[k])
-        print (" L ");
-      else
-        print (" S ");
-    print ("\n%*slms       ", depth, "");
-    for (k = 1; k < len; ++k)
-      if (!type[k] && type[k-1])
-        print (" ^ ");
-      else
-        print ("   ");
-    print ("\n%*ssufar  ", depth, "");
-    for (k = 0; k < len; ++k)
-      print ("%2d ", result[k]);
+/* libsa_ctx holds the options, the statistics and the workspace of a build.
+   Every function of the library takes all of its state from a ctx, which
+   makes builds with different contexts safe to run concurrently.  */
+struct libsa_ctx
+{
+    /* The stream to print the log to.  Logging is disabled when log is null.  */
+    FILE *log;
+    /* The number of threads to build on.  */
+    int nthreads;
+    /* Build the lcp array in place of the result, rather than in scratch
+       space.  */
+    int lowmem;
+    /* The checks of a build, one of enum libsa_check.  */
+    int check;
+    /* Measure the time of each phase of a build.  */
+    int timing;
+    /* Compact sparse alphabets of the input of a build.  */
+    int compact;
+    /* Treat the end of the input of a build as a sentinel, rather than
+       require the last symbol of the input to be the smallest.  */
+    int virtual_sentinel;
+    /* The sampling of the suffix array of an FM-index, one of enum
+       libsa_sampling.  */
+    int sampling;
+    /* When bwt is not null, the final induce pass of a build of an input of
+       bytes with a virtual sentinel stores the bwt of the input to bwt and
+       its primary index to primary.  */
+    void *bwt;
+    size_t primary;
+    struct libsa_stats stats;
+    /* The workspace, which either uses buf or a buffer supplied by the
+       caller.  */
+    struct workspace ws;
+    /* The directory of the temporary files that back a workspace larger
+       than ram_budget bytes.  Every workspace is in memory when scratch_dir
+       is null.  */
+    const char *scratch_dir;
+    size_t ram_budget;
+    /* The buffer owned by the context.  buf is reused across builds and grows
+       as needed.  */
+    void *buf;
+    size_t buflen;
+    /* buf is a mapping of a temporary file, rather than allocated.  */
+    int mapped;
+};
+
+/* The checks of a context with the default options.
+   The library built without asserts does not check anything by default.  */
+#ifdef NDEBUG
+enum {default_check = LIBSA_CHECK_NONE};
+#else
+enum {default_check = LIBSA_CHECK_CHEAP};
+#endif
+
+/* Assert expr when the checks of ctx are full.
+   expr is not evaluated otherwise, because the full checks take quadratic
+   time and memory on every call.  */
+#define assert_full(ctx, expr) \
+  assert ((ctx)->check < LIBSA_CHECK_FULL || (expr))
+
+/* Forward all arguments to vfprintf along with the log of ctx.
+   The only reason this function is used instead of printf is its ability to
+   avoid printing anything when logging is disabled.  */
+static void
+print (const struct libsa_ctx *ctx, const char *f, ...)
+{
+    va_list ap;
+    if (!ctx->log)
+      return;
+    va_start (ap, f);
+    vfprintf (ctx->log, f, ap);
+    va_end (ap);
+}
 
+/* Return the time in seconds, when the timing of ctx is enabled.
+   Return 0 otherwise, which makes the difference of two calls 0.  */
+static double
+now (const struct libsa_ctx *ctx)
+{
+    struct timespec ts;
 
-    print ("\n%*sbucke | 0|", depth, "");
-    for (k = 1; k < len; ++k)
-      {
-        /* buckets[x-1] is the beginning of the bucket for character x.
-           buckets[x]-1 is the end of the bucket for character x.  */
-        const int pos = result[k];
-        if (pos < 0)
-          continue;
-        const int c = input[pos];
-        const int beg = b[c-1];
-        const int end = b[c] - 1;
-        if (beg < 0)
-          continue;
-        b[c-1] = -1;
-        if (ascii && c > 31 && c < 127)
-          print ("%2c%*s|", (unsigned char) c, 3*(end - beg), "");
-        else
-          print ("%2d%*s|", c, 3*(end - beg), "");
-      }
-    print ("\n\n");
-    free (b);
+    if (!ctx->timing)
+      return 0;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
-/* Check that all initialized elements of result are unique.
-   Return 1 on success. Return 0 on failure.  */
-static int
-unique (const int *result, size_t len)
+/* The options of ctx_init that come from the environment.  The environment
+   is read once, when the library is loaded, rather than by every build.  */
+static FILE *env_log;
+static int env_check = default_check;
+
+/* Logging is enabled when environment variable LIBSA_LOG is set.
+   Environment variable LIBSA_CHECK overrides the default checks.  */
+__attribute__ ((constructor)) static void
+read_env (void)
 {
-    size_t k;
-    int *seen;
+    const char *check = getenv ("LIBSA_CHECK");
 
-    seen = alloc_init (-1, len);
-    for (k = 0; k < len; ++k)
-      if (result[k] >= 0)
-        {
-          assert (seen[result[k]] < 0);
-          seen[result[k]] = result[k];
-        }
-    free (seen);
-    return 1;
+    env_log = getenv ("LIBSA_LOG") ? stdout : 0;
+    if (check)
+      env_check = atoi (check);
 }
 
-/* Check that all elements of result are initialized and unique.
-   Return 1 on success. Return 0 on failure.  */
+/* Init ctx with the default options and without a workspace.  */
+static void
+ctx_init (struct libsa_ctx *ctx)
+{
+    memset (ctx, 0, sizeof *ctx);
+    ctx->log = env_log;
+    ctx->nthreads = 1;
+    ctx->compact = 1;
+    ctx->check = env_check;
+}
+
+/* A file mapped into memory.
+   addr is null when the file is empty, because an empty file cannot be
+   mapped.  */
+struct mapping
+{
+    void *addr;
+    size_t size;
+};
+
+/* Map the file at path read only into m.
+   Return 0 on success.
+   Return -1 and set errno on failure.  */
 static int
-all_unique (const int *result, size_t rlen, size_t len)
+map_input (struct mapping *m, const char *path)
 {
-    size_t k;
-    int *seen;
+    struct stat st;
+    int fd, err;
 
-    seen = alloc_init (-1, len);
-    for (k = 0; k < rlen; ++k)
+    m->addr = 0;
+    m->size = 0;
+    fd = open (path, O_RDONLY);
+    if (fd < 0)
+      return -1;
+    if (fstat (fd, &st) < 0)
+      goto fail;
+    m->size = st.st_size;
+    if (m->size > 0)
       {
-        assert (result[k] >= 0);
-        assert (seen[result[k]] < 0);
-        seen[result[k]] = result[k];
+        m->addr = mmap (0, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m->addr == MAP_FAILED)
+          {
+            m->addr = 0;
+            goto fail;
+          }
       }
-    free (seen);
-    return 1;
+    /* The mapping outlives the descriptor.  */
+    close (fd);
+    return 0;
+fail:
+    err = errno;
+    close (fd);
+    errno = err;
+    return -1;
 }
 
-/* Compare two zero terminated arrays of integers.
-   Return -1 if array x < array y.
-   Return 1 if array x > array y.
-   Return 0 if array x == array y.  */
+/* Create or truncate the file at path, grow it to size bytes and map it for
+   reading and writing into m.  The stores to m go to the file.
+   Return 0 on success.
+   Return -1 and set errno on failure.  */
 static int
-intcmp (const int *x, const int *y)
+map_output (struct mapping *m, const char *path, size_t size)
 {
-    for (; *x && *y; ++x, ++y)
+    int fd, err;
+
+    m->addr = 0;
+    m->size = size;
+    fd = open (path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+      return -1;
+    if (ftruncate (fd, size) < 0)
+      goto fail;
+    if (size > 0)
       {
-        if (*x > *y)
-          return 1;
-        if (*x < *y)
-          return -1;
+        m->addr = mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (m->addr == MAP_FAILED)
+          {
+            m->addr = 0;
+            goto fail;
+          }
       }
-    if (*x)
-      return 1;
-    if (*y)
-      return -1;
+    close (fd);
     return 0;
+fail:
+    err = errno;
+    close (fd);
+    errno = err;
+    return -1;
 }
 
-/* Check that the initialized elements of result are sorted.
-   Return 1 on success. Return 0 on failure.  */
+/* Tell the kernel how m is going to be accessed.
+   The advice is only a hint, which makes its failure harmless.  */
+static void
+advise (const struct mapping *m, int advice)
+{
+    if (m->addr)
+      madvise (m->addr, m->size, advice);
+}
+
+/* Unmap m, which writes the stores to a file mapped by map_output back to
+   the file.
+   Return 0 on success.
+   Return -1 and set errno on failure.  */
 static int
-sorted (const int *result, const int *input, size_t len, int depth)
+unmap (struct mapping *m)
 {
-    size_t k;
-    (void) depth;
+    int rc = 0;
+
+    if (m->addr)
+      rc = munmap (m->addr, m->size);
+    m->addr = 0;
+    return rc;
+}
 
-    for (k = 1; k < len; ++k)
+/* Map a new temporary file of size bytes in directory dir into m.
+   The file is unlinked right away, which makes the kernel reclaim its
+   blocks when m is unmapped, even if the process crashes.
+   Return 0 on success.
+   Return -1 and set errno on failure.  */
+static int
+map_scratch (struct mapping *m, const char *dir, size_t size)
+{
+    static const char name[] = "/libsa.XXXXXX";
+    char *path = alloc (strlen (dir) + sizeof name);
+    int fd, err;
+
+    m->addr = 0;
+    m->size = size;
+    strcat (strcpy (path, dir), name);
+    fd = mkstemp (path);
+    if (fd < 0)
+      {
+        free (path);
+        return -1;
+      }
+    unlink (path);
+    free (path);
+    if (ftruncate (fd, size) < 0)
+      goto fail;
+    if (size > 0)
       {
-        int pos, pos1;
-        while (k < len && result[k-1] < 0)
-          ++k;
-        pos = result[k-1];
-        if (k >= len)
-          break;
-        assert (pos >= 0);
-        while (k < len && result[k] < 0)
-          ++k;
-        if (k >= len)
-          break;
-        pos1 = result[k];
-        assert (pos1 >= 0);
-        if (intcmp (input + pos, input + pos1) >= 0)
+        m->addr = mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (m->addr == MAP_FAILED)
           {
-            assert (0);
-            return 0;
+            m->addr = 0;
+            goto fail;
           }
       }
-    return 1;
+    close (fd);
+    return 0;
+fail:
+    err = errno;
+    close (fd);
+    errno = err;
+    return -1;
 }
 
-/* Check that all elements of result are initialized and sorted.
-   Return 1 on success. Return 0 on failure.  */
-static int
-all_sorted (const int *result, const int *input, size_t len, int depth)
+/* Free the buffer of ctx.  */
+static void
+ctx_release (struct libsa_ctx *ctx)
 {
-    size_t k;
-    (void) depth;
+    if (ctx->mapped)
+      munmap (ctx->buf, ctx->buflen);
+    else
+      free (ctx->buf);
+    ctx->buf = 0;
+    ctx->buflen = 0;
+    ctx->mapped = 0;
+}
 
-    for (k = 1; k < len; ++k)
+/* Make the workspace of ctx at least size bytes large and empty.
+   The buffer of the workspace is reused when it is large enough.
+   A buffer larger than the ram budget of ctx is a mapping of a temporary
+   file in the scratch directory of ctx.
+   Return 0 on success.
+   Return -1 and set errno if the temporary file cannot be mapped.  */
+static int
+ctx_reserve (struct libsa_ctx *ctx, size_t size)
+{
+    if (ctx->buflen < size)
       {
-        const int pos = result[k-1], pos1 = result[k];
-        assert (pos >= 0);
-        assert (pos1 >= 0);
-        if (intcmp (input + pos, input + pos1) >= 0)
+        ctx_release (ctx);
+        if (ctx->scratch_dir && size > ctx->ram_budget)
           {
-            assert (0);
-            return 0;
+            struct mapping m;
+
+            if (map_scratch (&m, ctx->scratch_dir, size) < 0)
+              return -1;
+            ctx->buf = m.addr;
+            ctx->mapped = 1;
           }
+        else
+          ctx->buf = alloc (size);
+        ctx->buflen = size;
       }
-    return 1;
+    ws_init (&ctx->ws, ctx->buf, ctx->buflen);
+    return 0;
 }
 
-/* Return 1 if the last element of the input is the smallest.
-   Return 0 otherwise.
-   Suffix array requires that the last element is the smallest. This ensures
-   that no suffix is a prefix of another suffix. Which in turn ensures that
-   every suffix has its index in the suffix array.  */
-static int
-last_smallest (const unsigned char *input, size_t len)
+/* The layout of an index file, which is documented in libsa.h.  */
+enum {index_version = 1};
+enum {index_byteorder = 0x01020304};
+enum {index_alignment = 4096};
+enum {index_max_sections = 16};
+static const char index_magic[8] = "LIBSAIDX";
+
+struct index_section
+{
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct index_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint32_t width;
+    uint32_t nsections;
+    uint64_t len;
+    uint64_t checksum;
+    struct index_section section[index_max_sections];
+};
+
+/* An open index file.  */
+struct libsa_index
+{
+    struct mapping m;
+    const struct index_header *h;
+};
+
+/* Return the 64 bit fnv-1a hash of the len characters of input.  */
+static uint64_t
+checksum (const char *input, size_t len)
 {
+    uint64_t h = 0xcbf29ce484222325;
     size_t k;
 
-    for (k = 0; k < len - 2; ++k)
+    for (k = 0; k < len; ++k)
       {
-        assert (input[len-1] < input[k]);
-        if (input[len-1] >= input[k])
-          return 0;
+        h ^= (unsigned char) input[k];
+        h *= 0x100000001b3;
       }
-    return 1;
+    return h;
 }
 
-/* Compare the lms block starting at position 'x' with the lms block at
-   position 'y'. The lms blocks in 'input' are supposed to be sorted, even
-   though equal lms blocks may still need to be swapped. The lms block at
-   position 'x' <= the lms block at 'y'.
-   Return 0 if the lengths of the blocks match and values and types match
-   character for character for all characters.
-   Return 1 otherwise.  */
+/* Return 1 if a section whose id is id and whose size is size bytes may be
+   a section of an index of the len characters of a text, whose array
+   elements are width bytes.
+   Return 0 otherwise.  */
 static int
-lms_blocks_differ (const int *input, const int *type, size_t len, int x, int y)
+section_valid (uint32_t id, uint64_t size, size_t width, uint64_t len)
 {
-    if (x < 0)
+    if (id == 0)
+      return 0;
+    if (id >= LIBSA_SECTION_USER)
       return 1;
-    assert (x > 0);
-    assert ((size_t) x < len);
-    assert (y > 0);
-    assert ((size_t) y < len);
-
-    /* An infinite loop here is correct.
-       If the blocks differ, then one of the returns below in the loop returns 1.
-       If the blocks are equal, then 0 is returned from the loop below.
-       If one of the blocks is the last lms of the null terminator, then the
-       blocks differ, because the last lms block is unique.  */
-    for (;;)
-      if (input[x] != input[y])
-        /* Values differ.  */
-        return 1;
-      else if (type[x] != type[y])
-        /* Types differ.  */
-        return 1;
-      else if (type[x] && !type[x+1] && type[y] && !type[y+1])
-        /* The blocks are of the same length.
-           y+1 and x+1 are the ends of the respective blocks.  */
-        return input[x+1] != input[y+1];
-      else
-        ++y, ++x, assert ((size_t) y < len), assert ((size_t) x < len);
-}
-
-/* Give each lms block a name.
-   Store these names in lmsnames.
-   Give the same name to the lms blocks equal according to lms_blocks_differ.
-   When reduce is called lms blocks are supposed to be sorted in result.
-   Return the size of the reduced alphabet.  */
-static size_t
-reduce (int *lmsnames, const int *result, const int *input, const int *type,
-        size_t len, size_t lmslen, int depth)
-{
-    size_t k, j;
-    size_t abclen = 0;
-    int prior = -1;
-    int *name;
-
-    print ("%*sreducing ", depth, "");
-    print_array (input, len, depth == 0, 0);
-    name = alloc_init (-1, len);
-    name[len - 1] = abclen;
-    for (k = 1; k < len; ++k)
+    return size % width == 0 && size / width == len;
+}
+
+/* Write an index file of the len characters of input, whose suffix array
+   elements are width bytes, and of the nsections sections of sec to path.
+   Return 0 on success.
+   Return -1 and set errno on failure.  */
+static int
+index_save (const char *path, const char *input, size_t len, size_t width,
+            const struct libsa_section_data *sec, size_t nsections)
+{
+    struct index_header h;
+    struct mapping m;
+    size_t k, j, size;
+
+    if ((width != sizeof (int) && width != sizeof (int64_t))
+        || nsections > index_max_sections)
+      goto invalid;
+    for (k = 0; k < nsections; ++k)
       {
-        int pos;
-        pos = result[k];
-        if (pos > 0 && type[pos-1] && !type[pos])
-          {
-            /* pos is an lms position.  */
-            abclen += lms_blocks_differ (input, type, len, prior, pos);
-            name[pos] = abclen;
-            prior = pos;
-          }
+        if (!section_valid (sec[k].id, sec[k].size, width, len))
+          goto invalid;
+        for (j = 0; j < k; ++j)
+          if (sec[j].id == sec[k].id)
+            goto invalid;
+      }
+    memset (&h, 0, sizeof h);
+    memcpy (h.magic, index_magic, sizeof h.magic);
+    h.version = index_version;
+    h.byteorder = index_byteorder;
+    h.width = width;
+    h.nsections = nsections;
+    h.len = len;
+    h.checksum = checksum (input, len);
+    size = index_alignment;
+    for (k = 0; k < nsections; ++k)
+      {
+        h.section[k].id = sec[k].id;
+        h.section[k].offset = size;
+        h.section[k].size = sec[k].size;
+        size += (sec[k].size + index_alignment - 1)
+                / index_alignment * index_alignment;
       }
+    if (map_output (&m, path, size) < 0)
+      return -1;
+    memcpy (m.addr, &h, sizeof h);
+    for (k = 0; k < nsections; ++k)
+      memcpy ((char *) m.addr + h.section[k].offset, sec[k].data,
+              sec[k].size);
+    return unmap (&m);
+invalid:
+    errno = EINVAL;
+    return -1;
+}
+
+/* Return the section of index whose id is id.
+   Store the size of the section to size, unless size is null.
+   Return null if index has no such section.  */
+static const void *
+index_section (const struct libsa_index *index, uint32_t id, size_t *size)
+{
+    uint32_t k;
+
+    for (k = 0; k < index->h->nsections; ++k)
+      if (index->h->section[k].id == id)
+        {
+          if (size)
+            *size = index->h->section[k].size;
+          return (const char *) index->m.addr + index->h->section[k].offset;
+        }
+    return 0;
+}
+
+/* Return the array of the section of index whose id is id, when the elements
+   of the arrays of index are width bytes.
+   Return null otherwise.  */
+static const void *
+index_array (const struct libsa_index *index, uint32_t id, size_t width)
+{
+    if (index->h->width != width)
+      return 0;
+    return index_section (index, id, 0);
+}
+
+/* A pattern of a batch search.  */
+struct query
+{
+    const unsigned char *pattern;
+    size_t plen;
+    /* The index of the pattern in the batch.  */
+    size_t idx;
+};
+
+/* Compare the patterns of queries x and y, in the order of the suffixes of
+   a suffix array, in which a prefix precedes the longer strings.  */
+static int
+query_cmp (const void *x, const void *y)
+{
+    const struct query *a = x, *b = y;
+    const size_t n = a->plen < b->plen ? a->plen : b->plen;
+    int c = memcmp (a->pattern, b->pattern, n);
+
+    if (c)
+      return c;
+    return (a->plen > b->plen) - (a->plen < b->plen);
+}
+
+/* A bitvector that counts the ones before any position in constant time.
+   The bits are kept in blocks of 7 words, each preceded by the number of
+   ones before the block.  A block is then one cache line of 64 bytes, and a
+   rank takes one access to memory.  */
+enum {rank_block_words = 7, rank_block_bits = rank_block_words * 64};
+
+struct rank_block
+{
+    uint64_t ones;
+    uint64_t bits[rank_block_words];
+};
+
+struct bitvector
+{
+    struct rank_block *blocks;
+    size_t len;
+};
 
-    for (k = 0, j = 0; k < len; ++k)
-      if (name[k] >= 0)
-        lmsnames[j++] = name[k];
-    assert (j == lmslen);
+/* Return the number of blocks of a bitvector of len bits.
+   The last block is past the last bit, which makes bv_rank of len valid.  */
+static size_t
+bv_blocks (size_t len)
+{
+    return len / rank_block_bits + 1;
+}
+
+/* Init bv to len zero bits.  */
+static void
+bv_init (struct bitvector *bv, size_t len)
+{
+    const size_t size = bv_blocks (len) * sizeof *bv->blocks;
 
-    free (name);
-    ++abclen;
-    print ("%*sreduced abclen = %zu, lmslen = %zu\n", depth, "", abclen,
-           lmslen);
-    print ("%*sreduced lms names ", depth, "");
-    print_array (lmsnames, lmslen, 0, 0);
-    return abclen;
+    bv->blocks = aligned_alloc (sizeof *bv->blocks, size);
+    assert (bv->blocks);
+    memset (bv->blocks, 0, size);
+    bv->len = len;
 }
 
-/* Insert the indices of lms positions.  */
 static void
-insert_lms (int *result, const int *input, const int *buckets, int *lms,
-            size_t lmslen, size_t abclen, int depth)
+bv_free (struct bitvector *bv)
 {
-    size_t k;
-    int *b;
+    free (bv->blocks);
+    bv->blocks = 0;
+}
 
-    print ("%*sinserting lms positions\n", depth, "");
-    b = alloc_copy (buckets, abclen);
-    for (k = lmslen; k > 0; --k)
-      {
-        int pos; /* Position in result.  */
-        int inidx; /* Index in the input string.  */
-        unsigned int c;
-
-        inidx = lms[k-1];
-        c = input[inidx];
-        --b[c];
-        pos = b[c];
-        result[pos] = inidx;
-      }
-    free (b);
+static void
+bv_set (struct bitvector *bv, size_t k)
+{
+    struct rank_block *b = &bv->blocks[k / rank_block_bits];
+    k %= rank_block_bits;
+    b->bits[k / 64] |= (uint64_t) 1 << k % 64;
 }
 
-/* Induce the indices of L type positions from lms positions.  */
+static int
+bv_get (const struct bitvector *bv, size_t k)
+{
+    const struct rank_block *b = &bv->blocks[k / rank_block_bits];
+    k %= rank_block_bits;
+    return b->bits[k / 64] >> k % 64 & 1;
+}
+
+/* Store the number of ones before each block of bv, once all of the bits of
+   bv are set.  */
 static void
-induce_l (int *result, const int *input, const int *type, const int *buckets,
-          size_t len, size_t abclen, int depth)
+bv_finish (struct bitvector *bv)
 {
-    size_t k;
-    int *b;
+    size_t k, ones = 0;
+    int w;
 
-    print ("%*sinducing L positions from lms pos\n", depth, "");
-    b = alloc_copy (buckets, abclen);
-    /* Induce L positions from lms positions.
-       Scan from left to right.
-       If pos is L type, then put pos to the beginning of the bucket.  */
-    for (k = 0; k < len; ++k)
+    for (k = 0; k < bv_blocks (bv->len); ++k)
       {
-        unsigned int c; /* L type character that this iteration is inserting.  */
-        int bidx; /* The bucket index of the character that this iteration is inserting.  */
-        int pos = result[k]; /* Position in the suffix array.  */
-        if (pos <= 0)
-          continue;
-        --pos;
-        if (!type[pos])
-          /* S character.  */
-          continue;
-        c = input[pos];
-        assert (c > 0);
-        bidx = b[c-1];
-        ++b[c-1]; /* Advance bucket head.  */
-        result[bidx] = pos;
+        bv->blocks[k].ones = ones;
+        for (w = 0; w < rank_block_words; ++w)
+          ones += __builtin_popcountll (bv->blocks[k].bits[w]);
       }
-    free (b);
-    assert (unique (result, len));
 }
 
-/* Induce the indices of S type positions from the L type positions.  */
+/* Return the number of ones of bv before position k.  */
+static size_t
+bv_rank (const struct bitvector *bv, size_t k)
+{
+    const struct rank_block *b = &bv->blocks[k / rank_block_bits];
+    size_t r = b->ones;
+    size_t w;
+
+    k %= rank_block_bits;
+    for (w = 0; w < k / 64; ++w)
+      r += __builtin_popcountll (b->bits[w]);
+    if (k % 64)
+      r += __builtin_popcountll (b->bits[w] & (((uint64_t) 1 << k % 64) - 1));
+    return r;
+}
+
+/* The FM-index of a text of len characters followed by a sentinel.
+   The rows are the len + 1 sorted suffixes of the text with the sentinel.
+   Row 0 is the sentinel alone and row k + 1 is element k of the suffix
+   array of the text with a virtual sentinel.
+   The bwt of the rows is kept in a wavelet matrix of 8 levels, one for each
+   bit of a character from the most significant.  Level l holds bit l of the
+   characters, in the order of the characters stably sorted by their bits
+   before l, with the zeros first.  The sentinel, at row primary, is stored
+   as character 0 and is subtracted by fm_rank.
+   The suffix array is sampled either at the rows of the suffixes that start
+   at a multiple of rate, which are marked in sampled, or at the rows that
+   are a multiple of rate, one of enum libsa_sampling.  The inverse suffix
+   array is sampled at the positions that are a multiple of rate.  */
+struct libsa_fm
+{
+    size_t len;
+    size_t primary;
+    size_t rate;
+    int sampling;
+    /* c[x] is the first row of the suffixes that start with character x.  */
+    size_t c[UCHAR_MAX + 1];
+    struct bitvector level[CHAR_BIT];
+    /* The number of zeros of each level.  */
+    size_t zeros[CHAR_BIT];
+    /* start[x] is the index of the first x of the bwt below the last level,
+       where the characters are stably sorted by their bits from the least
+       significant.  An x that is not in the bwt has the index it would
+       have.  */
+    size_t start[UCHAR_MAX + 1];
+    struct bitvector sampled;
+    /* The samples of the suffix array in the order of rows and the samples
+       of the inverse suffix array in the order of positions.  A sample is
+       of uint32_t, unless wide is 1 and it is of uint64_t.  */
+    void *samples;
+    void *isamples;
+    int wide;
+};
+
+/* Store value to element k of the samples s of fm.  */
 static void
-induce_s (int *result, const int *input, const int *type, const int *buckets,
-          size_t len, size_t abclen, int depth)
-{
-    int k;
-    int *b;
-
-    print ("%*sinducing S positions from L positions\n", depth, "");
-    b = alloc_copy (buckets, abclen);
-    /* Induce S positions from L positions.
-       Scan from right to left.
-       If pos is S type, then put pos to the back of the bucket.  */
-    for (k = len - 1; k >= 0; --k)
-      {
-        unsigned int c; /* S type character that this iteration is inserting.  */
-        int bidx; /* The bucket index of the character that this iteration is inserting.  */
-        int pos = result[k]; /* Position in the suffix array.  */
-        if (pos <= 0)
-          continue;
-        --pos;
-        if (type[pos])
-          /* L character.  */
-          continue;
-        c = input[pos];
-        assert (c > 0);
-        bidx = b[c] - 1;
-        --b[c]; /* Retreat bucket tail.  */
-        /* This overwrites the lms characters inserted earlier.  */
-        result[bidx] = pos;
-      }
-    free (b);
-    assert (unique (result, len));
+set_sample (const struct libsa_fm *fm, void *s, size_t k, size_t value)
+{
+    if (fm->wide)
+      ((uint64_t *) s)[k] = value;
+    else
+      ((uint32_t *) s)[k] = value;
 }
 
-/* The top level function of the sais algorithm.
-   See "Linear Suffix Array Construction by Almost Pure Induced-Sorting"
-   by Ge Nong at al for the description of this algorithm.  */
-static int
-build (int *result, const int *input, size_t len, size_t abclen, int depth)
-{
-    int *lms, *lmsbuf;
-    /* lmslen contains the number of elements in lms array.
-       redabclen is the alphabet size of the reduced input.  */
-    size_t lmslen, redabclen;
-    int *type;
-    int *buckets;
-    size_t k;
+/* Return element k of the samples s of fm.  */
+static size_t
+get_sample (const struct libsa_fm *fm, const void *s, size_t k)
+{
+    return fm->wide ? ((const uint64_t *) s)[k] : ((const uint32_t *) s)[k];
+}
 
-    ++nrecursion;
+/* Return the number of samples of the suffix array and of the inverse
+   suffix array of fm.  */
+static size_t
+fm_nsamples (const struct libsa_fm *fm)
+{
+    return fm->len / fm->rate + 1;
+}
 
-    print ("%*sdepth = %d, len = %zu, abclen = %zu\n", depth, "", depth, len, abclen);
-    print ("%*sinput ", depth, "");
-    print_array (input, len, depth == 0, 0);
+static size_t
+fm_nisamples (const struct libsa_fm *fm)
+{
+    return (fm->len + fm->rate - 1) / fm->rate;
+}
 
-    /* Init type, buckets and lmslen.  */
-    buckets = alloc_init (0, abclen);
-    lmslen = 0;
-    type = alloc_init (0, len);
-    /* We'll use 0 for S and 1 for L types.  */
-    for (k = len - 1; k > 0; --k)
+/* Build the wavelet matrix of fm from the bwt l of len + 1 characters.
+   tmp is scratch space of len + 1 characters.  */
+static void
+fm_wavelet (struct libsa_fm *fm, unsigned char *l, unsigned char *tmp)
+{
+    const size_t n = fm->len + 1;
+    size_t k, z, o;
+    int lvl, x;
+
+    /* Lay out the characters below the last level by their counts, in the
+       order of their bits reversed.  */
+    memset (fm->start, 0, sizeof fm->start);
+    for (k = 0; k < n; ++k)
+      ++fm->start[l[k]];
+    for (k = 0, o = 0; k <= UCHAR_MAX; ++k)
       {
-        ++buckets[input[k]];
-        if (input[k-1] > input[k])
-          {
-            type[k-1] = 1;
-            if (!type[k])
-              /* input[0] can be an S type character.
-                 input[0] cannot be an lms character, by definition of lms. */
-              ++lmslen;
-          }
-        else if (input[k-1] == input[k])
-          /* This assignment requires a right to left walk.  */
-          type[k-1] = type[k];
+        size_t t;
+
+        for (lvl = 0, x = 0; lvl < CHAR_BIT; ++lvl)
+          x |= (k >> lvl & 1) << (CHAR_BIT - 1 - lvl);
+        t = fm->start[x];
+        fm->start[x] = o;
+        o += t;
       }
-    ++buckets[input[0]];
-    /* buckets has one element for each character in the alphabet.
-       buckets[x] is the number of characters in the input string that are <= x.
-       buckets[x-1] is the beginning of the bucket for character x.
-       buckets[x]-1 is the end of the bucket for character x.
-       buckets[x] is one past the end of the bucket for character x.
-       buckets[x] is the beginning of the bucket for character x+1.  */
-    for (k = 1; k < abclen; ++k)
-      buckets[k] += buckets[k-1];
-
-    /* Init lms.  */
-    lms = alloc (lmslen * sizeof *lms);
-    for (k = 0, lmslen = 0; k < len - 1; ++k)
-      if (type[k] > type[k+1])
-        lms[lmslen++] = k + 1;
-    print ("%*slmslen = %zu, lms positions", depth, "", lmslen);
-    print_array (lms, lmslen, 0, 0);
-    assert (all_unique (lms, lmslen, len));
-
-    /* Write indices of all lms characters to their respective buckets.  */
-    memset (result, -1, len * sizeof *result);
-    insert_lms (result, input, buckets, lms, lmslen, abclen, depth);
-    assert (unique (result, len));
-    induce_l (result, input, type, buckets, len, abclen, depth);
-    induce_s (result, input, type, buckets, len, abclen, depth);
-    /* At this point lms blocks are sorted in result.
-       However, equal lms blocks may still need to be swapped.  */
-
-    lmsbuf = alloc (lmslen * sizeof *lmsbuf);
-    redabclen = reduce (lmsbuf, result, input, type, len, lmslen, depth);
-    /* lmsbuf contains lms names.  */
-    if (redabclen == lmslen)
+    for (lvl = 0; lvl < CHAR_BIT; ++lvl)
       {
-        print ("%*seach lms block is unique, inducing L and S positions\n",
-               depth, "");
+        const int shift = CHAR_BIT - 1 - lvl;
+        unsigned char *t;
+
+        bv_init (&fm->level[lvl], n);
+        for (k = 0, z = 0; k < n; ++k)
+          if (l[k] >> shift & 1)
+            bv_set (&fm->level[lvl], k);
+          else
+            ++z;
+        bv_finish (&fm->level[lvl]);
+        fm->zeros[lvl] = z;
+        for (k = 0, o = z, z = 0; k < n; ++k)
+          if (l[k] >> shift & 1)
+            tmp[o++] = l[k];
+          else
+            tmp[z++] = l[k];
+        t = l;
+        l = tmp;
+        tmp = t;
       }
-    else
+}
+
+/* Store to *sp and *ep the number of occurrences of x in the bwt of fm
+   before rows *sp and *ep.
+   Rows *sp and *ep follow x down the levels to the index below the last
+   level of the first x at or after them, which is fm->start[x] plus the
+   number of occurrences of x before them.  */
+static void
+fm_rank (const struct libsa_fm *fm, int x, size_t *sp, size_t *ep)
+{
+    size_t b = *sp, e = *ep;
+    int lvl;
+
+    for (lvl = 0; lvl < CHAR_BIT; ++lvl)
       {
-        /* There are equal lms blocks. */
-        int *sa_of_lmsnames;
-
-        sa_of_lmsnames = alloc (lmslen * sizeof *sa_of_lmsnames);
-        print ("%*sfound equal lms blocks, building sa of lms names recursively\n",
-               depth, "");
-        build (sa_of_lmsnames, lmsbuf, lmslen, redabclen, depth + 3);
-        print ("%*ssa of lms names ", depth, "");
-        print_array (sa_of_lmsnames, lmslen, 0, 0);
-
-        /* Use sa_of_lmsnames to sort lms blocks in result.  */
-        print ("%*susing sa of lms names to sort lms positions\n", depth, "");
-        /* lms names are no longer needed.  Reuse lmsbuf to keep the indices of
-           lms positions sorted by the order in sa_of_lmsnames.  */
-        for (k = 0; k < lmslen; ++k)
+        const struct bitvector *bv = &fm->level[lvl];
+
+        if (x >> (CHAR_BIT - 1 - lvl) & 1)
           {
-            const int pos = sa_of_lmsnames[k];
-            const int idx = lms[pos];
-            lmsbuf[k] = idx;
+            b = fm->zeros[lvl] + bv_rank (bv, b);
+            e = fm->zeros[lvl] + bv_rank (bv, e);
+          }
+        else
+          {
+            b -= bv_rank (bv, b);
+            e -= bv_rank (bv, e);
           }
-        print ("%*ssorted lms positions ", depth, "");
-        print_array (lmsbuf, lmslen, 0, 0);
-        assert (all_unique (lmsbuf, lmslen, len));
-        assert (all_sorted (lmsbuf, input, lmslen, depth));
-
-        /* It is important to init result again to avoid different elements of
-           result having the same value.  */
-        memset (result, -1, len * sizeof *result);
-        insert_lms (result, input, buckets, lmsbuf, lmslen, abclen, depth);
-        assert (unique (result, len));
-        assert (sorted (result, input, len, depth));
-        free (sa_of_lmsnames);
       }
+    *sp = b - fm->start[x] - (x == 0 && *sp > fm->primary);
+    *ep = e - fm->start[x] - (x == 0 && *ep > fm->primary);
+}
 
-    /* At this point all (even equal) lms blocks in result are sorted.
-       Induce L and S positions from sorted lms blocks.  */
-    induce_l (result, input, type, buckets, len, abclen, depth);
-    induce_s (result, input, type, buckets, len, abclen, depth);
-    print_sa (result, input, type, buckets, len, abclen, depth);
-    assert (all_unique (result, len, len));
-    assert (all_sorted (result, input, len, depth));
-    print ("\n");
-
-    free (lmsbuf);
-    free (buckets);
-    free (lms);
-    free (type);
-    return 0;
+/* Return the row of the suffix one character longer than the suffix of
+   row, which is not the row of the suffix at 0.  */
+static size_t
+fm_lf (const struct libsa_fm *fm, size_t row)
+{
+    size_t k = row;
+    int lvl, x = 0;
+
+    assert (row != fm->primary);
+    /* Row follows its own character x down the levels, which also counts
+       the occurrences of x before row, as in fm_rank.  */
+    for (lvl = 0; lvl < CHAR_BIT; ++lvl)
+      {
+        const struct bitvector *bv = &fm->level[lvl];
+        const int bit = bv_get (bv, k);
+
+        x = x << 1 | bit;
+        k = bit ? fm->zeros[lvl] + bv_rank (bv, k) : k - bv_rank (bv, k);
+      }
+    return fm->c[x] + k - fm->start[x] - (x == 0 && row > fm->primary);
 }
 
-int
-libsa_build (int *result, const char *input, size_t len)
+/* The number of elements of a block and the number of blocks of a
+   superblock of the range minimum query of libsa.lce.h.  */
+enum {rmq_block = 64};
+
+/* Return the largest k such that 2^k <= x, for x > 0.  */
+static int
+floor_log2 (size_t x)
 {
-    size_t k;
-    int *copy, abclen = 0;
+    assert (x > 0);
+    return (int) (sizeof (unsigned long long) * CHAR_BIT - 1)
+           - __builtin_clzll (x);
+}
 
-    verbose = getenv ("LIBSA_LOG") != 0;
+/* Instantiate the sais core, the search and the lce for suffix arrays of
+   int.  */
+#define saidx_t int
+#define saidx_max INT_MAX
+#define SA_(name) name
+#include "libsa.core.h"
+#include "libsa.search.h"
+#include "libsa.lce.h"
+#undef SA_
+#undef saidx_max
+#undef saidx_t
+
+/* Instantiate the sais core, the search and the lce for suffix arrays of
+   int64_t.
+   This instance is separate from the int one, rather than the only one, to
+   keep the arrays of the int instance half the size.  */
+#define saidx_t int64_t
+#define saidx_max INT64_MAX
+#define SA_(name) name##64
+#include "libsa.core.h"
+#include "libsa.search.h"
+#include "libsa.lce.h"
+#undef SA_
+#undef saidx_max
+#undef saidx_t
+
+struct libsa_ctx *
+libsa_ctx_create (void)
+{
+    struct libsa_ctx *ctx = alloc (sizeof *ctx);
+    ctx_init (ctx);
+    return ctx;
+}
 
-    if (len < 2)
-      return *result = 0;
+void
+libsa_ctx_destroy (struct libsa_ctx *ctx)
+{
+    if (!ctx)
+      return;
+    ctx_release (ctx);
+    free (ctx);
+}
 
-    assert (last_smallest((const unsigned char*) input, len));
+void
+libsa_ctx_set_log (struct libsa_ctx *ctx, FILE *log)
+{
+    ctx->log = log;
+}
 
-    nrecursion = 0;
-    copy = alloc (len * sizeof *copy);
-    for (k = 0; k < len; ++k)
+void
+libsa_ctx_set_threads (struct libsa_ctx *ctx, int nthreads)
+{
+    ctx->nthreads = nthreads > 1 ? nthreads : 1;
+}
+
+void
+libsa_ctx_set_lowmem (struct libsa_ctx *ctx, int lowmem)
+{
+    ctx->lowmem = lowmem;
+}
+
+void
+libsa_ctx_set_timing (struct libsa_ctx *ctx, int timing)
+{
+    ctx->timing = timing;
+}
+
+void
+libsa_ctx_set_compact (struct libsa_ctx *ctx, int compact)
+{
+    ctx->compact = compact;
+}
+
+void
+libsa_ctx_set_virtual_sentinel (struct libsa_ctx *ctx, int virtual_sentinel)
+{
+    ctx->virtual_sentinel = virtual_sentinel;
+}
+
+void
+libsa_ctx_set_scratch_dir (struct libsa_ctx *ctx, const char *dir,
+                           size_t ram_budget)
+{
+    ctx->scratch_dir = dir;
+    ctx->ram_budget = ram_budget;
+}
+
+void
+libsa_ctx_set_sampling (struct libsa_ctx *ctx, int sampling)
+{
+    ctx->sampling = sampling;
+}
+
+void
+libsa_ctx_set_check (struct libsa_ctx *ctx, int check)
+{
+    ctx->check = check;
+}
+
+const struct libsa_stats *
+libsa_ctx_stats (const struct libsa_ctx *ctx)
+{
+    return &ctx->stats;
+}
+
+struct libsa_index *
+libsa_index_open (const char *path)
+{
+    struct libsa_index *index;
+    const struct index_header *h;
+    struct mapping m;
+    uint32_t k;
+
+    if (map_input (&m, path) < 0)
+      return 0;
+    h = m.addr;
+    if (m.size < sizeof *h || memcmp (h->magic, index_magic, sizeof h->magic)
+        || h->version != index_version || h->byteorder != index_byteorder
+        || (h->width != sizeof (int) && h->width != sizeof (int64_t))
+        || h->nsections > index_max_sections)
+      goto invalid;
+    for (k = 0; k < h->nsections; ++k)
       {
-        copy[k] = (unsigned char) input[k];
-        if (copy[k] >= abclen)
-          abclen = copy[k] + 1;
+        const struct index_section *sec = &h->section[k];
+        uint32_t j;
+
+        if (sec->offset % index_alignment || sec->offset > m.size
+            || sec->size > m.size - sec->offset
+            || !section_valid (sec->id, sec->size, h->width, h->len))
+          goto invalid;
+        for (j = 0; j < k; ++j)
+          if (h->section[j].id == sec->id)
+            goto invalid;
       }
-    build (result, copy, len, abclen, 0);
-    if (verbose)
-      printf ("recursion depth = %d\n", nrecursion - 1);
-    free (copy);
+    index = alloc (sizeof *index);
+    index->m = m;
+    index->h = h;
+    return index;
+invalid:
+    unmap (&m);
+    errno = EINVAL;
     return 0;
 }
 
+int
+libsa_index_save_sections (const char *path, const char *input, size_t len,
+                           size_t width, const struct libsa_section_data *sec,
+                           size_t nsections)
+{
+    return index_save (path, input, len, width, sec, nsections);
+}
+
+void
+libsa_index_close (struct libsa_index *index)
+{
+    if (!index)
+      return;
+    unmap (&index->m);
+    free (index);
+}
+
+size_t
+libsa_index_len (const struct libsa_index *index)
+{
+    return index->h->len;
+}
+
+const void *
+libsa_index_section (const struct libsa_index *index, uint32_t id,
+                     size_t *size)
+{
+    return index_section (index, id, size);
+}
 
-/* The top level function of the phi algorithm.
-   See "Permuted Longest-Common-Prefix Array"
-   by Juha Karkkainen at al for the description of this algorithm.  */
 int
-libsa_build_lcp (int *result, int *sa, const char *input, size_t len)
+libsa_index_check (const struct libsa_index *index, const char *input,
+                   size_t len)
 {
-    int *phi, *plcp;
-    size_t k;
-    int l;
+    if (len != index->h->len || checksum (input, len) != index->h->checksum)
+      return -1;
+    return 0;
+}
 
-    if (len < 2)
-      /* Need atleast 2 suffixes to have a common prefix.  */
-      return 0;
+void
+libsa_fm_destroy (struct libsa_fm *fm)
+{
+    int lvl;
+
+    if (!fm)
+      return;
+    for (lvl = 0; lvl < CHAR_BIT; ++lvl)
+      bv_free (&fm->level[lvl]);
+    bv_free (&fm->sampled);
+    free (fm->isamples);
+    free (fm->samples);
+    free (fm);
+}
+
+size_t
+libsa_fm_size (const struct libsa_fm *fm)
+{
+    const size_t levels = CHAR_BIT + (fm->sampling == LIBSA_SAMPLE_TEXT);
 
-    /* Build phi.  */
-    phi = alloc ((len - 1) * sizeof *phi);
-    for (k = 1; k < len; ++k)
-      phi[sa[k]] = sa[k-1];
+    return sizeof *fm
+           + levels * bv_blocks (fm->len + 1) * sizeof (struct rank_block)
+           + (fm_nsamples (fm) + fm_nisamples (fm))
+             * (fm->wide ? sizeof (uint64_t) : sizeof (uint32_t));
+}
 
-    /* Build plcp from phi.  */
-    plcp = alloc ((len - 1) * sizeof *plcp);
-    for (k = 0, l = 0; k < len - 1; ++k)
+size_t
+libsa_fm_count (const struct libsa_fm *fm, size_t *first, const char *pattern,
+                size_t plen)
+{
+    size_t sp = 1, ep = fm->len + 1, k;
+
+    /* Backward search, one character of pattern at a time from the last.  */
+    if (plen > 0)
+      sp = 0;
+    for (k = plen; k > 0 && sp < ep; --k)
       {
-        int j = phi[k];
-        while (input[k+l] == input[j+l])
-          ++l;
-        assert (l >= 0);
-        plcp[k] = l;
-        l = l ? l - 1 : 0;
+        const int x = (unsigned char) pattern[k-1];
+
+        fm_rank (fm, x, &sp, &ep);
+        sp += fm->c[x];
+        ep += fm->c[x];
       }
+    if (first)
+      *first = sp - 1;
+    return ep > sp ? ep - sp : 0;
+}
+
+size_t
+libsa_fm_sa (const struct libsa_fm *fm, size_t k)
+{
+    size_t row = k + 1, steps = 0;
 
-    /* Build lcp from plcp.  */
-    for (k = 1; k < len; ++k)
-      result[k] = plcp[sa[k]];
+    assert (k < fm->len);
+    if (fm->sampling == LIBSA_SAMPLE_RANK)
+      {
+        /* The walk ends at the latest at the suffix at 0.  */
+        for (; row % fm->rate && row != fm->primary; ++steps)
+          row = fm_lf (fm, row);
+        if (row == fm->primary)
+          return steps;
+        return get_sample (fm, fm->samples, row / fm->rate) + steps;
+      }
+    for (; !bv_get (&fm->sampled, row); ++steps)
+      row = fm_lf (fm, row);
+    return get_sample (fm, fm->samples, bv_rank (&fm->sampled, row)) + steps;
+}
 
-    print ("lcp    ");
-    print_array (result + 1, len - 1, 0, 0);
+size_t
+libsa_fm_isa (const struct libsa_fm *fm, size_t pos)
+{
+    size_t next, row;
 
-    free (plcp);
-    free (phi);
-    return 0;
+    assert (pos < fm->len);
+    /* Walk back from the next sampled position, or from the sentinel at row
+       0.  */
+    next = (pos + fm->rate - 1) / fm->rate;
+    if (next < fm_nisamples (fm))
+      {
+        row = get_sample (fm, fm->isamples, next);
+        next *= fm->rate;
+      }
+    else
+      {
+        row = 0;
+        next = fm->len;
+      }
+    for (; next > pos; --next)
+      row = fm_lf (fm, row);
+    return row - 1;
 }
 
 /* Copyright (c) 2025 Dmitry Goncharov
@@ -0,0 +1,832 @@
+/* The sais core.
+   libsa.c includes this file once for each index type.
+   Before each inclusion libsa.c defines
+   saidx_t, the type of the elements of the suffix array and of every other
+   array indexed by a position in the input,
+   saidx_max, the largest value of saidx_t, and
+   SA_(name), which gives each function of this file a name unique to the
+   index type.
+   This file includes libsa.sais.h once for each type of the symbols of the
+   input.  */
+
+#define alloc_init SA_(alloc_init)
+#define print_array SA_(print_array)
+#define unique SA_(unique)
+#define all_unique SA_(all_unique)
+#define stack_push SA_(stack_push)
+#define build_ws_size SA_(build_ws_size)
+#define par_ws_size SA_(par_ws_size)
+#define lcp_ws_size SA_(lcp_ws_size)
+#define permute_plcp SA_(permute_plcp)
+#define build_red SA_(build_red)
+
+/* alloc_init, unique and all_unique are only used by asserts.  */
+#ifndef NDEBUG
+/* Allocate an array of saidx_t of 'len' elements and memset it with 'value'.  */
+static saidx_t*
+alloc_init (int value, size_t len)
+{
+    saidx_t *r = alloc (len * sizeof *r);
+    return memset (r, value, len * sizeof *r);
+}
+
+/* Check that all initialized elements of result are unique.
+   Return 1 on success. Return 0 on failure.  */
+static int
+unique (const saidx_t *result, size_t len)
+{
+    size_t k;
+    saidx_t *seen;
+
+    seen = alloc_init (-1, len);
+    for (k = 0; k < len; ++k)
+      if (result[k] >= 0)
+        {
+          assert (seen[result[k]] < 0);
+          seen[result[k]] = result[k];
+        }
+    free (seen);
+    return 1;
+}
+
+/* Check that all elements of result are initialized and unique.
+   Return 1 on success. Return 0 on failure.  */
+static int
+all_unique (const saidx_t *result, size_t rlen, size_t len)
+{
+    size_t k;
+    saidx_t *seen;
+
+    seen = alloc_init (-1, len);
+    for (k = 0; k < rlen; ++k)
+      {
+        assert (result[k] >= 0);
+        assert (seen[result[k]] < 0);
+        seen[result[k]] = result[k];
+      }
+    free (seen);
+    return 1;
+}
+
+#endif
+
+/* Print len elements of input either as character or integers.  */
+static void
+print_array (const struct libsa_ctx *ctx, const saidx_t *input, size_t len, int ascii, int depth)
+{
+    size_t k;
+
+    if (!ctx->log)
+      return;
+
+    print (ctx, "%*s", depth, "");
+    for (k = 0; k < len; ++k)
+      if (ascii && input[k] > 31 && input[k] < 127)
+        print (ctx, " %c ", (char) input[k]);
+      else
+        print (ctx, " %lld ", (long long) input[k]);
+    print (ctx, "\n");
+}
+
+/* Push index k of lcp to stack, which holds top elements.
+   The elements of lcp referenced by stack are strictly increasing from the
+   bottom to the top.  Return the new number of elements.  */
+static size_t
+stack_push (saidx_t *stack, size_t top, const saidx_t *lcp, saidx_t k)
+{
+    while (top > 0 && lcp[stack[top-1]] >= lcp[k])
+      --top;
+    stack[top] = k;
+    return top + 1;
+}
+
+/* Return the size of the workspace that build needs to build the suffix
+   array of an input of len elements with the alphabet of abclen characters.
+   Each level of recursion allocates type, buckets and the scratch copy of
+   buckets, and releases them before the next level.  The input of the next
+   level is at most half as long as the input of the current level and has
+   at most as many characters as elements.  */
+static size_t
+build_ws_size (size_t len, size_t abclen)
+{
+    size_t r = 0;
+
+    for (; len > 1; len /= 2, abclen = len)
+      {
+        const size_t level = ws_round (type_words (len) * sizeof (uint64_t))
+                             + ws_round (abclen * sizeof (saidx_t))
+                             + ws_round ((abclen + 1) * sizeof (saidx_t));
+        if (level > r)
+          r = level;
+      }
+    return r;
+}
+
+/* Return the size of the workspace that build needs on top of build_ws_size
+   to run on ctx->nthreads threads.  */
+static size_t
+par_ws_size (const struct libsa_ctx *ctx)
+{
+    if (ctx->nthreads < 2)
+      return 0;
+    return ws_round (4 * induce_block * sizeof (saidx_t))
+           + ws_round (ctx->nthreads * sizeof (size_t))
+           + ws_round (ctx->nthreads * classify_abclen * sizeof (saidx_t));
+}
+
+/* Return the size of the workspace that build needs on top of build_ws_size
+   to also build the lcp array of an input of len elements with the alphabet
+   of abclen characters.
+   This is the lcp values of at most len / 2 lms positions, last, sstart and
+   the stack of induce_lcp.  */
+static size_t
+lcp_ws_size (size_t len, size_t abclen)
+{
+    return ws_round (len / 2 * sizeof (saidx_t))
+           + 2 * ws_round (abclen * sizeof (saidx_t))
+           + ws_round (len * sizeof (saidx_t));
+}
+
+/* Permute plcp into lcp in place.
+   Store in lcp[k] the value of lcp[sa[k]] for every k.
+   Each cycle of the permutation is walked once.  The elements that are
+   already moved are marked by storing their one's complement.  */
+static void
+permute_plcp (saidx_t *lcp, const saidx_t *sa, size_t len)
+{
+    size_t k;
+
+    for (k = 0; k < len; ++k)
+      {
+        saidx_t j, first;
+
+        if (lcp[k] < 0)
+          continue;
+        first = lcp[k];
+        for (j = k; (size_t) sa[j] != k; j = sa[j])
+          lcp[j] = ~lcp[sa[j]];
+        lcp[j] = ~first;
+      }
+    for (k = 0; k < len; ++k)
+      lcp[k] = ~lcp[k];
+}
+
+/* The reduced input, whose symbols are of saidx_t.  */
+#define sym_t saidx_t
+#define SYM_(name) SA_(name##_red)
+#include "libsa.sais.h"
+#undef SYM_
+#undef sym_t
+
+/* The input of the library.  */
+#define SAIS_INPUT
+#define sym_t unsigned char
+#define SYM_(name) SA_(name##_u8)
+#include "libsa.sais.h"
+#undef SYM_
+#undef sym_t
+#define sym_t uint16_t
+#define SYM_(name) SA_(name##_u16)
+#include "libsa.sais.h"
+#undef SYM_
+#undef sym_t
+#define sym_t uint32_t
+#define SYM_(name) SA_(name##_u32)
+#include "libsa.sais.h"
+#undef SYM_
+#undef sym_t
+#undef SAIS_INPUT
+
+size_t
+SA_(libsa_workspace_size) (size_t len, size_t abclen)
+{
+    /* Either the scratch space of build or the rank array of verify.  */
+    const size_t b = build_ws_size (len, abclen);
+    const size_t v = ws_round (len * sizeof (saidx_t));
+    return b > v ? b : v;
+}
+
+int
+SA_(libsa_build_ws) (saidx_t *result, const char *input, size_t len,
+                     void *wsbuf, size_t wslen)
+{
+    struct libsa_ctx ctx;
+    const unsigned char *in = (const unsigned char *) input;
+
+    ctx_init (&ctx);
+    ws_init (&ctx.ws, wsbuf, wslen);
+    return SA_(build_top_u8) (&ctx, result, 0, in, len,
+                              SA_(alphabet_size_u8) (in, len));
+}
+
+int
+SA_(libsa_ctx_build) (struct libsa_ctx *ctx, saidx_t *result,
+                      const char *input, size_t len)
+{
+    return SA_(ctx_build_u8) (ctx, result, 0, (const unsigned char *) input,
+                              len, 0);
+}
+
+int
+SA_(libsa_build) (saidx_t *result, const char *input, size_t len)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_build) (&ctx, result, input, len);
+    ctx_release (&ctx);
+    return rc;
+}
+
+int
+SA_(libsa_ctx_build_sa_lcp) (struct libsa_ctx *ctx, saidx_t *sa, saidx_t *lcp,
+                             const char *input, size_t len)
+{
+    return SA_(ctx_build_u8) (ctx, sa, lcp, (const unsigned char *) input, len,
+                              0);
+}
+
+int
+SA_(libsa_build_sa_lcp) (saidx_t *sa, saidx_t *lcp, const char *input,
+                         size_t len)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_build_sa_lcp) (&ctx, sa, lcp, input, len);
+    ctx_release (&ctx);
+    return rc;
+}
+
+int
+SA_(libsa_ctx_build_sym) (struct libsa_ctx *ctx, saidx_t *sa, saidx_t *lcp,
+                          const void *input, size_t symsize, size_t len,
+                          size_t abclen)
+{
+    switch (symsize)
+      {
+        case sizeof (unsigned char):
+          return SA_(ctx_build_u8) (ctx, sa, lcp, input, len, abclen);
+        case sizeof (uint16_t):
+          return SA_(ctx_build_u16) (ctx, sa, lcp, input, len, abclen);
+        case sizeof (uint32_t):
+          return SA_(ctx_build_u32) (ctx, sa, lcp, input, len, abclen);
+      }
+    return -1;
+}
+
+int
+SA_(libsa_build_sym) (saidx_t *sa, saidx_t *lcp, const void *input,
+                      size_t symsize, size_t len, size_t abclen)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_build_sym) (&ctx, sa, lcp, input, symsize, len, abclen);
+    ctx_release (&ctx);
+    return rc;
+}
+
+int
+SA_(libsa_ctx_verify) (struct libsa_ctx *ctx, const saidx_t *sa,
+                       const char *input, size_t len)
+{
+    saidx_t *rank;
+    int ok;
+
+    if (ctx_reserve (ctx, ws_round (len * sizeof *rank)) < 0)
+      return -1;
+    rank = ws_alloc (&ctx->ws, len * sizeof *rank);
+    ok = SA_(verify_u8) (rank, sa, (const unsigned char *) input, len);
+    ws_free (&ctx->ws, rank);
+    return ok ? 0 : -1;
+}
+
+int
+SA_(libsa_verify) (const saidx_t *sa, const char *input, size_t len)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_verify) (&ctx, sa, input, len);
+    ctx_release (&ctx);
+    return rc;
+}
+
+
+int
+SA_(libsa_ctx_build_lcp) (struct libsa_ctx *ctx, saidx_t *result,
+                          saidx_t *sa, const char *input, size_t len)
+{
+    if (len < 2)
+      /* Need atleast 2 suffixes to have a common prefix.  */
+      return 0;
+    if (!ctx->lowmem
+        && ctx_reserve (ctx, 2 * ws_round (len * sizeof *sa)) < 0)
+      return -1;
+    SA_(phi_lcp_u8) (ctx, result, sa, (const unsigned char *) input, len);
+    return 0;
+}
+
+int
+SA_(libsa_build_lcp) (saidx_t *result, saidx_t *sa, const char *input,
+                      size_t len)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_build_lcp) (&ctx, result, sa, input, len);
+    ctx_release (&ctx);
+    return rc;
+}
+
+/* The suffix array and the lcp array are built directly in the mapped
+   output files.  The input is read at random positions by the induce passes
+   of build, which makes readahead on a fault useless.  The whole input is
+   requested up front instead.  The phi algorithm then scans sa and input
+   in order, apart from the predecessor of each suffix, and benefits from
+   readahead.  */
+int
+SA_(libsa_ctx_build_file) (struct libsa_ctx *ctx, const char *input_path,
+                           const char *sa_path, const char *lcp_path)
+{
+    struct mapping in, sa, lcp = {0, 0};
+    const int virt = ctx->virtual_sentinel;
+    size_t len;
+    int rc = -1, err = 0;
+
+    if (map_input (&in, input_path) < 0)
+      return -1;
+    len = in.size;
+    if (len > (size_t) saidx_max)
+      {
+        errno = EOVERFLOW;
+        unmap (&in);
+        return -1;
+      }
+    if (map_output (&sa, sa_path, len * sizeof (saidx_t)) < 0)
+      {
+        err = errno;
+        unmap (&in);
+        errno = err;
+        return -1;
+      }
+    if (lcp_path && map_output (&lcp, lcp_path, len * sizeof (saidx_t)) < 0)
+      {
+        err = errno;
+        unmap (&sa);
+        unmap (&in);
+        errno = err;
+        return -1;
+      }
+
+    rc = 0;
+    if (len > 0)
+      {
+        advise (&in, MADV_WILLNEED);
+        advise (&in, MADV_RANDOM);
+        ctx->virtual_sentinel = 1;
+        errno = 0;
+        rc = SA_(ctx_build_u8) (ctx, sa.addr, 0, in.addr, len, 0);
+        err = errno;
+        ctx->virtual_sentinel = virt;
+      }
+    if (rc == 0 && lcp.addr)
+      {
+        saidx_t *l = lcp.addr;
+
+        advise (&in, MADV_SEQUENTIAL);
+        advise (&sa, MADV_SEQUENTIAL);
+        l[0] = 0;
+        errno = 0;
+        rc = SA_(libsa_ctx_build_lcp) (ctx, l, sa.addr, in.addr, len);
+        err = errno;
+      }
+    /* A build that cannot map its scratch space sets errno.  A build that
+       fails otherwise, on the checks of ctx, does not.  */
+    if (rc < 0 && err == 0)
+      err = EINVAL;
+    if (rc == 0)
+      err = 0;
+    if (unmap (&lcp) < 0)
+      rc = -1, err = errno;
+    if (unmap (&sa) < 0)
+      rc = -1, err = errno;
+    unmap (&in);
+    errno = err;
+    return rc;
+}
+
+int
+SA_(libsa_ctx_bwt) (struct libsa_ctx *ctx, char *bwt, size_t *primary,
+                    const char *input, size_t len)
+{
+    const int virt = ctx->virtual_sentinel;
+    saidx_t *sa;
+    int rc;
+
+    if (len > (size_t) saidx_max)
+      return -1;
+    if (len < 2)
+      {
+        if (len == 1)
+          bwt[0] = input[0];
+        *primary = len;
+        return 0;
+      }
+    /* The suffix array is built in scratch space and discarded.  */
+    if (ctx_reserve (ctx, ws_round (len * sizeof *sa)
+                          + SA_(libsa_workspace_size) (len, UCHAR_MAX + 1)
+                          + par_ws_size (ctx)) < 0)
+      return -1;
+    sa = ws_alloc (&ctx->ws, len * sizeof *sa);
+    ctx->virtual_sentinel = 1;
+    ctx->bwt = bwt;
+    bwt[0] = input[len-1];
+    rc = SA_(build_top_u8) (ctx, sa, 0, (const unsigned char *) input, len,
+                            UCHAR_MAX + 1);
+    *primary = ctx->primary;
+    ctx->bwt = 0;
+    ctx->virtual_sentinel = virt;
+    ws_free (&ctx->ws, sa);
+    return rc;
+}
+
+int
+SA_(libsa_bwt) (char *bwt, size_t *primary, const char *input, size_t len)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_bwt) (&ctx, bwt, primary, input, len);
+    ctx_release (&ctx);
+    return rc;
+}
+
+/* The rows of the bwt are the len + 1 sorted suffixes of the input with the
+   sentinel.  Row 0 is the suffix of the sentinel alone and row primary is
+   the suffix at 0, whose preceding character is the sentinel, which is not
+   stored in bwt.  The text is decoded from the back, from row 0, by the lf
+   mapping, which takes the row of a suffix to the row of the suffix one
+   character longer.  */
+int
+SA_(libsa_ctx_unbwt) (struct libsa_ctx *ctx, char *output, const char *bwt,
+                      size_t len, size_t primary)
+{
+    const unsigned char *l = (const unsigned char *) bwt;
+    size_t count[UCHAR_MAX + 1] = {0};
+    saidx_t *lf;
+    size_t k, n, i;
+
+    if (len > (size_t) saidx_max || primary > len || (len > 0 && primary == 0))
+      return -1;
+    if (len == 0)
+      return 0;
+    if (ctx_reserve (ctx, ws_round ((len + 1) * sizeof *lf)) < 0)
+      return -1;
+    lf = ws_alloc (&ctx->ws, (len + 1) * sizeof *lf);
+    for (k = 0; k < len; ++k)
+      ++count[l[k]];
+    /* count[c] becomes the row of the first suffix that starts with c.  */
+    for (k = 0, n = 1; k <= UCHAR_MAX; ++k)
+      {
+        const size_t t = count[k];
+        count[k] = n;
+        n += t;
+      }
+    lf[primary] = 0;
+    for (k = 0; k < len; ++k)
+      lf[k + (k >= primary)] = count[l[k]]++;
+    for (i = 0, k = len; k > 0; --k)
+      {
+        output[k-1] = bwt[i - (i > primary)];
+        i = lf[i];
+      }
+    ws_free (&ctx->ws, lf);
+    return 0;
+}
+
+int
+SA_(libsa_unbwt) (char *output, const char *bwt, size_t len, size_t primary)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_unbwt) (&ctx, output, bwt, len, primary);
+    ctx_release (&ctx);
+    return rc;
+}
+
+/* The documents are concatenated without separators and the suffix array
+   of the concatenation is built with a virtual sentinel.
+   The tail of a suffix is its characters up to the end of its document.
+   The suffixes of the concatenation that start with a tail are an interval
+   of its suffix array.  In the collection, the suffix of the tail precedes
+   the other suffixes of the interval, which are longer than the tail there.
+   The suffixes of the collection are then sorted by the first element of
+   the interval of their tail, then by the length of the tail and then by
+   the document, which is a unique key of each suffix.  The key is sorted
+   by two counting sorts, by the length of the tail and then by the first
+   element of the interval, of the suffixes in the order of the text, which
+   is the order of the documents.
+   The first element of the interval of the suffix at k of sa is the last
+   j <= k whose lcp[j] is smaller than the length of the tail, which is
+   found by a binary search of the stack of stack_push.  */
+int
+SA_(libsa_ctx_build_docs) (struct libsa_ctx *ctx, saidx_t *sa, saidx_t *docs,
+                           const char *const *inputs, const size_t *lens,
+                           size_t ndocs)
+{
+    const int virt = ctx->virtual_sentinel;
+    size_t len = 0, maxlen = 0, top, d, i, j, k, n, build, rest;
+    saidx_t *lcp, *key, *order, *cnt, *stack;
+    unsigned char *text;
+    int rc;
+
+    for (d = 0; d < ndocs; ++d)
+      {
+        if (lens[d] > (size_t) saidx_max - len)
+          return -1;
+        len += lens[d];
+        if (lens[d] > maxlen)
+          maxlen = lens[d];
+      }
+    if (ndocs > (size_t) saidx_max)
+      return -1;
+    if (len == 0)
+      return 0;
+
+    /* key and lcp are kept throughout.  On top of them are either the text
+       and the scratch space of its build, or the stack, or order.  */
+    build = ws_round (len) + SA_(libsa_workspace_size) (len, UCHAR_MAX + 1)
+            + lcp_ws_size (len, UCHAR_MAX + 1) + par_ws_size (ctx);
+    rest = ws_round (len * sizeof *order);
+    if (ws_round ((maxlen + 1) * sizeof *stack) > rest)
+      rest = ws_round ((maxlen + 1) * sizeof *stack);
+    if (ctx_reserve (ctx, ws_round (len * sizeof *key)
+                          + ws_round ((len + 1) * sizeof *lcp)
+                          + (build > rest ? build : rest)) < 0)
+      return -1;
+    key = ws_alloc (&ctx->ws, len * sizeof *key);
+    lcp = ws_alloc (&ctx->ws, (len + 1) * sizeof *lcp);
+    text = ws_alloc (&ctx->ws, len);
+    for (d = 0, i = 0; d < ndocs; i += lens[d++])
+      if (lens[d] > 0)
+        memcpy (text + i, inputs[d], lens[d]);
+    ctx->virtual_sentinel = 1;
+    rc = SA_(build_top_u8) (ctx, sa, lcp, text, len, UCHAR_MAX + 1);
+    ctx->virtual_sentinel = virt;
+    ws_free (&ctx->ws, text);
+    if (rc < 0)
+      {
+        ws_free (&ctx->ws, key);
+        return rc;
+      }
+
+    /* docs holds the document of each position of the text, and key the
+       length of its tail, until key is replaced by the first element of
+       the interval.  */
+    for (d = 0, i = 0; d < ndocs; ++d)
+      for (k = 0; k < lens[d]; ++k, ++i)
+        {
+          docs[i] = d;
+          key[i] = lens[d] - k;
+        }
+    /* The lcp values are cut to maxlen, which bounds the stack.  */
+    stack = ws_alloc (&ctx->ws, (maxlen + 1) * sizeof *stack);
+    for (k = 0, top = 0; k < len; ++k)
+      {
+        const saidx_t r = key[sa[k]];
+        size_t lo, hi;
+
+        if ((size_t) lcp[k] > maxlen)
+          lcp[k] = maxlen;
+        top = stack_push (stack, top, lcp, k);
+        /* The bottom of the stack is an lcp of 0, which is smaller than any
+           r.  */
+        for (lo = 0, hi = top; hi - lo > 1;)
+          {
+            const size_t m = lo + (hi - lo) / 2;
+
+            if (lcp[stack[m]] < r)
+              lo = m;
+            else
+              hi = m;
+          }
+        key[sa[k]] = stack[lo];
+      }
+    ws_free (&ctx->ws, stack);
+
+    /* Sort the suffixes by the length of their tail to order and then by
+       the first element of their interval to sa.  cnt[t] becomes the first
+       element of the output for t.  */
+    order = ws_alloc (&ctx->ws, len * sizeof *order);
+    cnt = lcp;
+    memset (cnt, 0, (maxlen + 1) * sizeof *cnt);
+    for (d = 0; d < ndocs; ++d)
+      for (k = 0; k < lens[d]; ++k)
+        ++cnt[lens[d]-k];
+    for (k = 0, n = 0; k <= maxlen; ++k)
+      {
+        const size_t t = cnt[k];
+        cnt[k] = n;
+        n += t;
+      }
+    for (d = 0, i = 0; d < ndocs; ++d)
+      for (k = 0; k < lens[d]; ++k, ++i)
+        order[cnt[lens[d]-k]++] = i;
+    memset (cnt, 0, len * sizeof *cnt);
+    for (i = 0; i < len; ++i)
+      ++cnt[key[i]];
+    for (k = 0, n = 0; k < len; ++k)
+      {
+        const size_t t = cnt[k];
+        cnt[k] = n;
+        n += t;
+      }
+    for (j = 0; j < len; ++j)
+      sa[cnt[key[order[j]]]++] = order[j];
+
+    memcpy (key, docs, len * sizeof *key);
+    for (k = 0; k < len; ++k)
+      docs[k] = key[sa[k]];
+    ctx->stats.peak_scratch = ctx->ws.peak;
+    ws_free (&ctx->ws, key);
+    return 0;
+}
+
+int
+SA_(libsa_build_docs) (saidx_t *sa, saidx_t *docs, const char *const *inputs,
+                       const size_t *lens, size_t ndocs)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_build_docs) (&ctx, sa, docs, inputs, lens, ndocs);
+    ctx_release (&ctx);
+    return rc;
+}
+
+struct libsa_fm *
+SA_(libsa_ctx_fm_build) (struct libsa_ctx *ctx, const char *input, size_t len,
+                         size_t rate)
+{
+    const unsigned char *in = (const unsigned char *) input;
+    const int virt = ctx->virtual_sentinel;
+    const size_t sasize = ws_round (len * sizeof (saidx_t))
+                          + SA_(libsa_workspace_size) (len, UCHAR_MAX + 1)
+                          + par_ws_size (ctx);
+    struct libsa_fm *fm;
+    unsigned char *l, *tmp;
+    saidx_t *sa;
+    size_t k, n = 0;
+    int rc;
+
+    if (len > (size_t) saidx_max || rate == 0)
+      return 0;
+    /* The bwt is kept below the suffix array in scratch space.  Once the
+       bwt is stored, the suffix array and its scratch space are released
+       and the space of the wavelet matrix takes their place.  */
+    if (ctx_reserve (ctx, ws_round (len + 1)
+                          + (sasize > ws_round (len + 1) ? sasize
+                                                         : ws_round (len + 1)))
+        < 0)
+      return 0;
+    l = ws_alloc (&ctx->ws, len + 1);
+    sa = ws_alloc (&ctx->ws, len * sizeof *sa);
+    ctx->virtual_sentinel = 1;
+    rc = SA_(build_top_u8) (ctx, sa, 0, in, len, UCHAR_MAX + 1);
+    ctx->virtual_sentinel = virt;
+    if (rc < 0)
+      {
+        ws_free (&ctx->ws, l);
+        return 0;
+      }
+
+    fm = alloc (sizeof *fm);
+    memset (fm, 0, sizeof *fm);
+    fm->len = len;
+    fm->rate = rate;
+    fm->sampling = ctx->sampling;
+    fm->wide = len > UINT32_MAX;
+    fm->samples = alloc (fm_nsamples (fm) * (fm->wide ? 8 : 4));
+    fm->isamples = alloc (fm_nisamples (fm) * (fm->wide ? 8 : 4));
+    if (fm->sampling == LIBSA_SAMPLE_TEXT)
+      bv_init (&fm->sampled, len + 1);
+    /* Row 0 is the sentinel alone, whose suffix starts at len.  */
+    l[0] = len > 0 ? in[len-1] : 0;
+    for (k = 0; k <= len; ++k)
+      {
+        const size_t pos = k > 0 ? (size_t) sa[k-1] : len;
+
+        if (k > 0 && pos == 0)
+          {
+            fm->primary = k;
+            l[k] = 0;
+          }
+        else if (k > 0)
+          l[k] = in[pos-1];
+        if (fm->sampling == LIBSA_SAMPLE_RANK)
+          {
+            if (k % rate == 0)
+              set_sample (fm, fm->samples, k / rate, pos);
+          }
+        else if (pos % rate == 0)
+          {
+            bv_set (&fm->sampled, k);
+            set_sample (fm, fm->samples, n++, pos);
+          }
+        if (pos < len && pos % rate == 0)
+          set_sample (fm, fm->isamples, pos / rate, k);
+      }
+    if (fm->sampling == LIBSA_SAMPLE_TEXT)
+      bv_finish (&fm->sampled);
+    ws_free (&ctx->ws, sa);
+
+    for (k = 0; k < len; ++k)
+      ++fm->c[in[k]];
+    for (k = 0, n = 1; k <= UCHAR_MAX; ++k)
+      {
+        const size_t t = fm->c[k];
+        fm->c[k] = n;
+        n += t;
+      }
+    tmp = ws_alloc (&ctx->ws, len + 1);
+    fm_wavelet (fm, l, tmp);
+    ws_free (&ctx->ws, l);
+    return fm;
+}
+
+struct libsa_fm *
+SA_(libsa_fm_build) (const char *input, size_t len, size_t rate)
+{
+    struct libsa_fm *fm;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    fm = SA_(libsa_ctx_fm_build) (&ctx, input, len, rate);
+    ctx_release (&ctx);
+    return fm;
+}
+
+int
+SA_(libsa_index_save) (const char *path, const char *input, size_t len,
+                       const saidx_t *sa, const saidx_t *lcp)
+{
+    const struct libsa_section_data sec[] = {
+        {LIBSA_SECTION_SA, sa, len * sizeof *sa},
+        {LIBSA_SECTION_LCP, lcp, len * sizeof *lcp},
+    };
+    return index_save (path, input, len, sizeof *sa, sec, lcp ? 2 : 1);
+}
+
+const saidx_t *
+SA_(libsa_index_sa) (const struct libsa_index *index)
+{
+    return index_array (index, LIBSA_SECTION_SA, sizeof (saidx_t));
+}
+
+const saidx_t *
+SA_(libsa_index_lcp) (const struct libsa_index *index)
+{
+    return index_array (index, LIBSA_SECTION_LCP, sizeof (saidx_t));
+}
+
+int
+SA_(libsa_build_file) (const char *input_path, const char *sa_path,
+                       const char *lcp_path)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_build_file) (&ctx, input_path, sa_path, lcp_path);
+    ctx_release (&ctx);
+    return rc;
+}
+
+#undef alloc_init
+#undef print_array
+#undef unique
+#undef all_unique
+#undef stack_push
+#undef build_ws_size
+#undef par_ws_size
+#undef lcp_ws_size
+#undef build_red
+#undef permute_plcp
+
+/* Copyright (c) 2025 Dmitry Goncharov
+ * dgoncharov@users.sf.net.
+ *
+ * Distributed under GPL v2 or the BSD License (see accompanying file copying),
+ * your choice.
+ */
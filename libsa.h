@@ -2,6 +2,8 @@
 #define _LIBSA_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -12,9 +14,26 @@ extern "C" {
    It is caller's responsibility to allocate result of the same size as input.
    input does not have to be null terminated, but input[len - 1] has to be
    smaller than any element of input between (and including) 0 and len - 2.
-   Return 0.  */
+   Return 0 on success.
+   Return -1 if the suffix array fails the checks of libsa_ctx_set_check.  */
 int libsa_build (int *result, const char *input, size_t len);
 
+/* Return the size in bytes of the workspace that libsa_build_ws needs to build
+   the suffix array of input of len characters, when each character of input
+   is less than abclen.  abclen is at most 256.  */
+size_t libsa_workspace_size (size_t len, size_t abclen);
+
+/* The same as libsa_build, except that libsa_build_ws does not allocate any
+   memory.  Instead, libsa_build_ws takes all of its scratch space from ws.
+   ws is a buffer of wslen bytes, aligned to at least 16 bytes.
+   The size of the workspace is returned by libsa_workspace_size.
+   A workspace can be reused by any number of calls to libsa_build_ws, but not
+   by concurrent calls.
+   Return 0 on success.
+   Return -1 if wslen is too small.  */
+int libsa_build_ws (int *result, const char *input, size_t len, void *ws,
+                    size_t wslen);
+
 /* Store in result the lengths of the longest common prefixes of the pairs of
    adjacent suffixes of the specified sa.
    libsa_build_lcp runs in linear time and occupies linear space.
@@ -22,6 +41,636 @@ int libsa_build (int *result, const char *input, size_t len);
    Return 0.  */
 int libsa_build_lcp (int *result, int *sa, const char *input, size_t len);
 
+/* Store in sa the suffix array of input and in lcp the lcp array of sa.
+   This is the same as libsa_build followed by libsa_build_lcp, except that
+   libsa_build_sa_lcp derives the lcp values while it sorts the suffixes,
+   rather than in a separate pass over sa and input.
+   It is caller's responsibility to allocate sa and lcp of the same size as
+   input.
+   lcp[0] is set to 0.
+   Return 0 on success.
+   Return -1 if the suffix array fails the checks of libsa_ctx_set_check.  */
+int libsa_build_sa_lcp (int *sa, int *lcp, const char *input, size_t len);
+
+/* The same as libsa_build, libsa_workspace_size, libsa_build_ws,
+   libsa_build_lcp and libsa_build_sa_lcp, except that the elements of the
+   suffix array and the lcp array are of type int64_t.
+   These functions are suitable for inputs longer than INT_MAX.  */
+int libsa_build64 (int64_t *result, const char *input, size_t len);
+size_t libsa_workspace_size64 (size_t len, size_t abclen);
+int libsa_build_ws64 (int64_t *result, const char *input, size_t len, void *ws,
+                      size_t wslen);
+int libsa_build_lcp64 (int64_t *result, int64_t *sa, const char *input,
+                       size_t len);
+int libsa_build_sa_lcp64 (int64_t *sa, int64_t *lcp, const char *input,
+                          size_t len);
+
+/* The same as libsa_build_sa_lcp, except that input is an array of len
+   symbols of symsize bytes each.  symsize is 1 for uint8_t, 2 for uint16_t
+   and 4 for uint32_t symbols.
+   Each symbol is less than abclen.  When abclen is 0, the alphabet size is
+   computed from input.
+   The build reads input directly, rather than a copy of input.
+   lcp can be null, in which case only the suffix array is built.
+   Return 0 on success.
+   Return -1 if symsize is not supported or abclen is too large for the type
+   of the suffix array.  */
+int libsa_build_sym (int *sa, int *lcp, const void *input, size_t symsize,
+                     size_t len, size_t abclen);
+int libsa_build_sym64 (int64_t *sa, int64_t *lcp, const void *input,
+                       size_t symsize, size_t len, size_t abclen);
+
+/* Build the generalized suffix array of the ndocs documents of inputs,
+   document d of lens[d] characters, in sa and the document array in docs.
+   The suffixes of the collection are the suffixes of each document.  They
+   are sorted as if each document ended with a sentinel of its own, smaller
+   than any character, the sentinel of document d smaller than that of
+   document d + 1.  A suffix that is a prefix of another suffix precedes
+   it, and equal suffixes of several documents are in the order of the
+   documents.  The documents can hold any bytes and need no
+   separators.
+   The elements of sa are the positions of the suffixes in the concatenation
+   of the documents in order.  docs[k] is the document of the suffix at
+   sa[k].
+   It is caller's responsibility to allocate sa and docs of as many
+   elements as the total length of the documents.
+   Return 0 on success.
+   Return -1 if the total length or ndocs is too large for the type of the
+   elements of sa.  */
+int libsa_build_docs (int *sa, int *docs, const char *const *inputs,
+                      const size_t *lens, size_t ndocs);
+int libsa_build_docs64 (int64_t *sa, int64_t *docs, const char *const *inputs,
+                        const size_t *lens, size_t ndocs);
+
+/* Build the suffix array of the contents of the file at input_path and
+   write it to the file at sa_path, which is created or truncated.  When
+   lcp_path is not null, also write the lcp array to the file at lcp_path.
+   The output files hold len elements of type int in the byte order of the
+   host, where len is the size of the input file.  lcp[0] is 0.
+   The input file is mapped read only and the arrays are built directly in
+   the mapped output files, which avoids reading the input into a buffer
+   and writing the arrays out.
+   The input file can hold any bytes.  The end of the file is treated as a
+   sentinel, as described in libsa_ctx_set_virtual_sentinel.
+   Return 0 on success.
+   Return -1 and set errno on failure.  errno is EOVERFLOW when the input
+   file is too large for the type of the elements of the suffix array.  */
+int libsa_build_file (const char *input_path, const char *sa_path,
+                      const char *lcp_path);
+int libsa_build_file64 (const char *input_path, const char *sa_path,
+                        const char *lcp_path);
+
+/* Store to llcp and rlcp the lcps of the bounds with the midpoints of the
+   binary searches of libsa_locate over the suffix array whose lcp array is
+   lcp.  llcp[m] is the lcp of the suffix at m with the suffix at the lower
+   bound of the interval whose midpoint is m, and rlcp[m] with the one at
+   the upper bound.
+   It is caller's responsibility to allocate llcp and rlcp of the same size
+   as input.
+   libsa_build_lcplr runs in linear time.
+   Return 0.  */
+int libsa_build_lcplr (int *llcp, int *rlcp, const int *lcp, size_t len);
+int libsa_build_lcplr64 (int64_t *llcp, int64_t *rlcp, const int64_t *lcp,
+                         size_t len);
+
+/* Find the suffixes of input of len characters that start with pattern of
+   plen characters.  These suffixes are adjacent in the suffix array sa.
+   Store the index in sa of the first of them to first, unless first is
+   null, and return their number.  When there are none, first is the index
+   at which pattern would be inserted in sa.
+   When llcp and rlcp are those of libsa_build_lcplr, the search takes
+   O (plen + log len) character comparisons.  When llcp and rlcp are null,
+   each step of the search skips the characters that pattern has in common
+   with both bounds of the interval, which takes O (plen * log len)
+   comparisons at worst and about as few as with llcp and rlcp on typical
+   inputs.
+   input does not have to be null terminated.  The search does not read
+   beyond input[len - 1].  */
+size_t libsa_locate (size_t *first, const int *sa, const int *llcp,
+                     const int *rlcp, const char *input, size_t len,
+                     const char *pattern, size_t plen);
+size_t libsa_locate64 (size_t *first, const int64_t *sa, const int64_t *llcp,
+                       const int64_t *rlcp, const char *input, size_t len,
+                       const char *pattern, size_t plen);
+
+/* The same as libsa_locate, except that only the number of the suffixes is
+   returned.  */
+size_t libsa_count (const int *sa, const int *llcp, const int *rlcp,
+                    const char *input, size_t len, const char *pattern,
+                    size_t plen);
+size_t libsa_count64 (const int64_t *sa, const int64_t *llcp,
+                      const int64_t *rlcp, const char *input, size_t len,
+                      const char *pattern, size_t plen);
+
+/* Find the suffixes of input of len characters that start with each of the
+   npatterns patterns, patterns[k] of plens[k] characters.  Store to
+   count[k] and, unless first is null, to first[k] what libsa_locate
+   returns and stores to first for patterns[k].
+   The patterns are sorted first, which makes neighbouring patterns share
+   their prefixes.  The search narrows the interval of sa one character of
+   a pattern at a time and reuses the intervals of the prefix shared with
+   the previous pattern.  A batch of many patterns takes fewer accesses to
+   sa and input than a libsa_locate per pattern.
+   Return 0.  */
+int libsa_locate_batch (size_t *first, size_t *count, const int *sa,
+                        const char *input, size_t len,
+                        const char *const *patterns, const size_t *plens,
+                        size_t npatterns);
+int libsa_locate_batch64 (size_t *first, size_t *count, const int64_t *sa,
+                          const char *input, size_t len,
+                          const char *const *patterns, const size_t *plens,
+                          size_t npatterns);
+
+/* The longest common extension of any two suffixes of a text, which is
+   the smallest element of the lcp array between the ranks of the suffixes.
+   The structure keeps a range minimum query over the lcp array, about 1/2
+   bit per element of int, or 1 bit per element of int64_t, and the inverse
+   suffix array unless the caller provides one.  */
+struct libsa_lce;
+struct libsa_lce64;
+
+/* Build the longest common extension structure of the text of len
+   characters whose suffix array is sa and lcp array is lcp.
+   isa is the inverse suffix array of sa, isa[sa[k]] == k, or null.  When
+   isa is null, the inverse suffix array is built, len elements of the type
+   of sa, 32 or 64 bits per character, which is most of the size of the
+   structure.  A caller that keeps the inverse suffix array anyway saves
+   this memory by passing it.
+   The structure refers to lcp and isa, which are to outlive it.  lcp[0] is
+   not read and does not have to be set.
+   libsa_lce_build runs in linear time.
+   Return the structure.  */
+struct libsa_lce *libsa_lce_build (const int *sa, const int *lcp,
+                                   const int *isa, size_t len);
+struct libsa_lce64 *libsa_lce_build64 (const int64_t *sa, const int64_t *lcp,
+                                       const int64_t *isa, size_t len);
+
+/* Free lce.  */
+void libsa_lce_destroy (struct libsa_lce *lce);
+void libsa_lce_destroy64 (struct libsa_lce64 *lce);
+
+/* Return the smallest element of the lcp array of lce from x to y,
+   inclusive, 0 < x <= y < len.
+   The query reads at most 4 runs of 64 elements and 2 other elements,
+   regardless of the length of the range.  */
+int libsa_lce_rmq (const struct libsa_lce *lce, size_t x, size_t y);
+int64_t libsa_lce_rmq64 (const struct libsa_lce64 *lce, size_t x, size_t y);
+
+/* Return the length of the common prefix of the suffixes at positions i and
+   j of the text of lce, in constant time.  */
+size_t libsa_lce (const struct libsa_lce *lce, size_t i, size_t j);
+size_t libsa_lce64 (const struct libsa_lce64 *lce, size_t i, size_t j);
+
+/* Store to bwt the Burrows-Wheeler transform of input of len characters
+   and to primary its primary index.
+   The end of input is treated as a sentinel smaller than any character, as
+   described in libsa_ctx_set_virtual_sentinel, which makes the transform
+   that of input followed by the sentinel.  The sentinel itself is not
+   stored.  bwt has len characters, bwt[0] is input[len - 1] and primary is
+   the index that the sentinel would have in the transform, which is 1 plus
+   the rank of the suffix at 0.  This is the layout of the bwt of
+   divsufsort.
+   The transform is emitted by the final pass of the build over the suffix
+   array, rather than read from a complete suffix array in another pass.
+   The suffix array is kept in scratch space of len elements of int and is
+   discarded.
+   Return 0 on success.
+   Return -1 if len is too large for the scratch suffix array.  */
+int libsa_bwt (char *bwt, size_t *primary, const char *input, size_t len);
+int libsa_bwt64 (char *bwt, size_t *primary, const char *input, size_t len);
+
+/* Store to output the len characters whose transform is bwt with primary
+   index primary, as stored by libsa_bwt.
+   The scratch space is an array of len + 1 elements of int.
+   Return 0 on success.
+   Return -1 if primary is not a valid primary index of len characters.  */
+int libsa_unbwt (char *output, const char *bwt, size_t len, size_t primary);
+int libsa_unbwt64 (char *output, const char *bwt, size_t len,
+                   size_t primary);
+
+/* An FM-index of a text, which counts the occurrences of a pattern without
+   the text and without the suffix array.
+   The index keeps the bwt of the text in a wavelet matrix with rank
+   blocks, about 1.15 bytes per character, and one element of the suffix
+   array and one element of the inverse suffix array out of every rate, 4
+   bytes each, or 8 bytes for a text of 2^32 characters or longer.
+   The index is a compressed suffix array too, whose elements are recovered
+   on demand by libsa_fm_sa and libsa_fm_isa.  */
+struct libsa_fm;
+
+/* The sampling of the suffix array of an FM-index.
+   LIBSA_SAMPLE_TEXT keeps the elements of the suffix array that are a
+   multiple of rate, along with a bitvector of their indices, 1.15 bits per
+   character.  libsa_fm_sa then takes at most rate - 1 steps.
+   LIBSA_SAMPLE_RANK keeps the elements whose index is a multiple of rate,
+   without the bitvector.  libsa_fm_sa then takes about rate steps on a
+   typical text, but as many steps as the element itself at worst.  */
+enum libsa_sampling
+{
+    LIBSA_SAMPLE_TEXT,
+    LIBSA_SAMPLE_RANK
+};
+
+/* Build the FM-index of input of len characters.  The end of input is
+   treated as a sentinel, as described in libsa_ctx_set_virtual_sentinel.
+   The suffix array is sampled at the suffixes that start at a multiple of
+   rate.  A larger rate makes the index smaller and libsa_fm_sa and
+   libsa_fm_isa slower, which take up to rate - 1 steps.
+   The suffix array is built in memory of len elements of int, which is
+   freed before the index is returned.  libsa_fm_build64 builds it of
+   int64_t, for inputs longer than INT_MAX.
+   Return the index on success.
+   Return null if rate is 0 or if len is too large.  */
+struct libsa_fm *libsa_fm_build (const char *input, size_t len, size_t rate);
+struct libsa_fm *libsa_fm_build64 (const char *input, size_t len,
+                                   size_t rate);
+
+/* Free fm.  */
+void libsa_fm_destroy (struct libsa_fm *fm);
+
+/* Return the size of fm in bytes.  */
+size_t libsa_fm_size (const struct libsa_fm *fm);
+
+/* Return the number of the suffixes of the text of fm that start with
+   pattern of plen characters.  Store the index in the suffix array of the
+   first of them to first, unless first is null.  first is unspecified when
+   there are none.
+   The search takes 16 rank queries for each character of pattern, two for
+   each level of the wavelet matrix, which do not depend on the length of
+   the text.  */
+size_t libsa_fm_count (const struct libsa_fm *fm, size_t *first,
+                       const char *pattern, size_t plen);
+
+/* Return element k of the suffix array of the text of fm, which is the
+   position in the text of an occurrence found by libsa_fm_count for k from
+   first to first + count - 1.  */
+size_t libsa_fm_sa (const struct libsa_fm *fm, size_t k);
+
+/* Return element pos of the inverse suffix array of the text of fm, which
+   is the index in the suffix array of the suffix at pos.
+   This takes up to rate - 1 steps.  */
+size_t libsa_fm_isa (const struct libsa_fm *fm, size_t pos);
+
+/* Return 0 if sa is the suffix array of input.
+   Return -1 otherwise.
+   libsa_verify runs in linear time and occupies linear space.
+   Unlike libsa_build, libsa_verify accepts any input, including the one whose
+   last character is not the smallest.  */
+int libsa_verify (const int *sa, const char *input, size_t len);
+int libsa_verify64 (const int64_t *sa, const char *input, size_t len);
+
+/* A context holds the options, the statistics and the reusable scratch space
+   of a build.  The functions that take a context do not use any global state.
+   Builds with different contexts can run concurrently.
+   A context cannot be used by concurrent builds.  */
+struct libsa_ctx;
+
+/* The largest depth of recursion whose statistics are kept.
+   Each level of recursion halves the input, which makes the depth of
+   recursion of any input smaller than this.  */
+enum {LIBSA_MAX_DEPTH = 64};
+
+/* The statistics of one level of recursion of a build.  */
+struct libsa_level_stats
+{
+    /* The length and the alphabet size of the input of the level.  */
+    size_t len;
+    size_t abclen;
+    /* The number of lms positions and the alphabet size of the reduced input,
+       which is the input of the next level.  */
+    size_t lmslen;
+    size_t redabclen;
+};
+
+/* The statistics of the last build made with a context.
+   The times are in seconds, summed over all levels of recursion, and are
+   only measured when timing is enabled with libsa_ctx_set_timing.  */
+struct libsa_stats
+{
+    /* The depth of recursion.  */
+    int depth;
+    /* levels[0] through levels[depth] describe each level of recursion.  */
+    struct libsa_level_stats levels[LIBSA_MAX_DEPTH];
+    /* The time spent in the classification of positions as L and S type.  */
+    double classify_time;
+    /* The time spent inserting the lms positions into their buckets.  */
+    double insert_lms_time;
+    /* The time spent inducing L and S positions.  */
+    double induce_l_time;
+    double induce_s_time;
+    /* The time spent naming lms blocks.  */
+    double reduce_time;
+    /* The time spent building the lcp array, including the fused induce
+       passes of libsa_ctx_build_sa_lcp.  */
+    double lcp_time;
+    /* The largest number of bytes of scratch space used at once.  */
+    size_t peak_scratch;
+};
+
+/* Allocate a context with the default options.
+   Logging is enabled when environment variable LIBSA_LOG is set.
+   LIBSA_LOG and LIBSA_CHECK are read once, when the library is loaded.  */
+struct libsa_ctx *libsa_ctx_create (void);
+
+/* Free ctx and its scratch space.  */
+void libsa_ctx_destroy (struct libsa_ctx *ctx);
+
+/* Print the log of every build made with ctx to log.
+   Null log disables logging.  */
+void libsa_ctx_set_log (struct libsa_ctx *ctx, FILE *log);
+
+/* Build suffix arrays and lcp arrays on nthreads threads.
+   The default is 1.
+   The library has to be built with OpenMP for nthreads to have effect.  */
+void libsa_ctx_set_threads (struct libsa_ctx *ctx, int nthreads);
+
+/* When lowmem is not 0, build lcp arrays with no scratch space.
+   libsa_ctx_build_lcp then stores phi and then the permuted lcp array in
+   result and permutes result into the lcp array in place.  This reduces the
+   memory of the build from sa, result and 2 scratch arrays to sa and result,
+   at the cost of a slower, single threaded, final permutation.
+   In this mode result[0] is set to 0.
+   The default is 0.  */
+void libsa_ctx_set_lowmem (struct libsa_ctx *ctx, int lowmem);
+
+/* The checks that a build makes.  */
+enum libsa_check
+{
+    /* No checks.  */
+    LIBSA_CHECK_NONE,
+    /* Check the built suffix array with libsa_verify.  */
+    LIBSA_CHECK_CHEAP,
+    /* In addition, check the partially sorted suffix array after each step
+       of the build.  These checks take quadratic time on repetitive inputs
+       and only have effect when the library is built with asserts.  */
+    LIBSA_CHECK_FULL
+};
+
+/* Select the checks of every build made with ctx.
+   A build whose suffix array fails the checks returns -1.
+   The default is LIBSA_CHECK_CHEAP, or LIBSA_CHECK_NONE when the library is
+   built with NDEBUG.  Environment variable LIBSA_CHECK overrides the
+   default.  */
+void libsa_ctx_set_check (struct libsa_ctx *ctx, int check);
+
+/* When compact is not 0, libsa_ctx_build_sym maps the symbols of an input
+   whose alphabet is larger than 256 symbols and less than half used to a
+   dense alphabet of the used symbols before the build.  The mapping keeps
+   the order of the symbols, which keeps the suffix array the same.  This
+   shrinks the arrays of the build that have an element for each symbol of
+   the alphabet, at the cost of a scan of input and a copy of input.
+   The default is 1.  */
+void libsa_ctx_set_compact (struct libsa_ctx *ctx, int compact);
+
+/* Back the scratch space of every build made with ctx that needs more than
+   ram_budget bytes of it by a temporary file in directory dir, rather than
+   by memory.  The file is deleted right after it is created.  dir has to
+   stay valid for as long as ctx uses it.  A null dir keeps all of the
+   scratch space in memory, which is the default.
+   Together with libsa_ctx_build_file, which keeps the input and the output
+   arrays in files, this builds the suffix array of an input larger than the
+   memory.  The suffix array is the same as the one built in memory.  The
+   kernel keeps the pages of the files that are in use in memory and writes
+   the rest back to the files.  The induce passes over an input of bytes
+   read the suffix array in order and write it at the heads of at most 256
+   buckets, each of which moves in order, which keeps the accesses to the
+   files close to sequential.  Only the input and the bitset of its types,
+   len / 8 bytes, are read at random.  The reduced input of the next level
+   is at most half as long and is sorted within the suffix array.
+   A build whose temporary file cannot be created or mapped returns -1 and
+   sets errno.  */
+void libsa_ctx_set_scratch_dir (struct libsa_ctx *ctx, const char *dir,
+                                size_t ram_budget);
+
+/* Select the sampling of the suffix array of every FM-index built with ctx,
+   one of enum libsa_sampling.
+   The default is LIBSA_SAMPLE_TEXT.  */
+void libsa_ctx_set_sampling (struct libsa_ctx *ctx, int sampling);
+
+/* When virtual_sentinel is not 0, every build made with ctx treats the end
+   of input as a sentinel smaller than any symbol, rather than require that
+   input[len - 1] is smaller than every other symbol of input.  Any buffer,
+   including one that contains zeros or a read only mapping of a file, can
+   then be indexed in place.  The suffix array still has len elements, one
+   for each suffix of input.  A suffix that is a prefix of another suffix
+   precedes that suffix.
+   libsa_ctx_build_sa_lcp and libsa_ctx_build_sym then build the lcp array
+   with the algorithm of libsa_ctx_build_lcp after the suffix array, rather
+   than along with it.
+   The default is 0.  */
+void libsa_ctx_set_virtual_sentinel (struct libsa_ctx *ctx,
+                                     int virtual_sentinel);
+
+/* When timing is not 0, measure the time of each phase of every build made
+   with ctx.
+   The default is 0.  */
+void libsa_ctx_set_timing (struct libsa_ctx *ctx, int timing);
+
+/* Return the statistics of the last build made with ctx.
+   libsa_ctx_build and libsa_ctx_build_sa_lcp replace all statistics.
+   libsa_ctx_build_lcp replaces only the time of the lcp phase and raises
+   peak_scratch to its own peak, which keeps the statistics of the suffix
+   array that the lcp array is built from.  */
+const struct libsa_stats *libsa_ctx_stats (const struct libsa_ctx *ctx);
+
+/* The same as libsa_build, libsa_build_lcp, libsa_build_sa_lcp,
+   libsa_verify and libsa_build_sym, except that these functions take the
+   options from ctx and reuse the scratch space of ctx.
+   The scratch space grows to the size required by the largest input.
+   libsa_ctx_build_sa_lcp induces the lcp values on one thread, regardless of
+   the number of threads of ctx.  */
+int libsa_ctx_build (struct libsa_ctx *ctx, int *result, const char *input,
+                     size_t len);
+int libsa_ctx_build_lcp (struct libsa_ctx *ctx, int *result, int *sa,
+                         const char *input, size_t len);
+int libsa_ctx_build_sa_lcp (struct libsa_ctx *ctx, int *sa, int *lcp,
+                            const char *input, size_t len);
+int libsa_ctx_verify (struct libsa_ctx *ctx, const int *sa, const char *input,
+                      size_t len);
+int libsa_ctx_build_sym (struct libsa_ctx *ctx, int *sa, int *lcp,
+                         const void *input, size_t symsize, size_t len,
+                         size_t abclen);
+int libsa_ctx_build64 (struct libsa_ctx *ctx, int64_t *result,
+                       const char *input, size_t len);
+int libsa_ctx_build_lcp64 (struct libsa_ctx *ctx, int64_t *result,
+                           int64_t *sa, const char *input, size_t len);
+int libsa_ctx_build_sa_lcp64 (struct libsa_ctx *ctx, int64_t *sa,
+                              int64_t *lcp, const char *input, size_t len);
+int libsa_ctx_verify64 (struct libsa_ctx *ctx, const int64_t *sa,
+                        const char *input, size_t len);
+int libsa_ctx_build_sym64 (struct libsa_ctx *ctx, int64_t *sa, int64_t *lcp,
+                           const void *input, size_t symsize, size_t len,
+                           size_t abclen);
+
+/* The same as libsa_build_docs and libsa_build_docs64, except that these
+   functions take the options from ctx and reuse the scratch space of ctx.
+   The scratch space holds a copy of the concatenation of the documents,
+   its lcp array and the keys of the sort of the suffixes, about 2 elements
+   of sa and 1 byte per character on top of the scratch space of a build.
+   peak_scratch of libsa_ctx_stats counts all of them.
+   Return -1 and set errno if the scratch space cannot be mapped.  */
+int libsa_ctx_build_docs (struct libsa_ctx *ctx, int *sa, int *docs,
+                          const char *const *inputs, const size_t *lens,
+                          size_t ndocs);
+int libsa_ctx_build_docs64 (struct libsa_ctx *ctx, int64_t *sa,
+                            int64_t *docs, const char *const *inputs,
+                            const size_t *lens, size_t ndocs);
+
+/* The same as libsa_bwt, libsa_bwt64, libsa_unbwt and libsa_unbwt64,
+   except that these functions take the options from ctx and reuse the
+   scratch space of ctx.  libsa_ctx_bwt uses the threads of ctx and the
+   virtual sentinel regardless of the options of ctx.  */
+int libsa_ctx_bwt (struct libsa_ctx *ctx, char *bwt, size_t *primary,
+                   const char *input, size_t len);
+int libsa_ctx_bwt64 (struct libsa_ctx *ctx, char *bwt, size_t *primary,
+                     const char *input, size_t len);
+int libsa_ctx_unbwt (struct libsa_ctx *ctx, char *output, const char *bwt,
+                     size_t len, size_t primary);
+int libsa_ctx_unbwt64 (struct libsa_ctx *ctx, char *output, const char *bwt,
+                       size_t len, size_t primary);
+
+/* The same as libsa_fm_build and libsa_fm_build64, except that these
+   functions use the threads of ctx to build the suffix array, and keep the
+   suffix array and the bwt in the scratch space of ctx, which later builds
+   reuse.
+   Return null and set errno also if the scratch space cannot be mapped.  */
+struct libsa_fm *libsa_ctx_fm_build (struct libsa_ctx *ctx, const char *input,
+                                     size_t len, size_t rate);
+struct libsa_fm *libsa_ctx_fm_build64 (struct libsa_ctx *ctx,
+                                       const char *input, size_t len,
+                                       size_t rate);
+
+/* The same as libsa_locate_batch and libsa_locate_batch64, except that
+   the sorted patterns are split into runs searched on the threads of ctx
+   and the scratch space is that of ctx.
+   Return 0 on success.
+   Return -1 and set errno if the scratch space cannot be mapped.  */
+int libsa_ctx_locate_batch (struct libsa_ctx *ctx, size_t *first,
+                            size_t *count, const int *sa, const char *input,
+                            size_t len, const char *const *patterns,
+                            const size_t *plens, size_t npatterns);
+int libsa_ctx_locate_batch64 (struct libsa_ctx *ctx, size_t *first,
+                              size_t *count, const int64_t *sa,
+                              const char *input, size_t len,
+                              const char *const *patterns,
+                              const size_t *plens, size_t npatterns);
+
+/* The same as libsa_build_file and libsa_build_file64, except that these
+   functions take the options from ctx and reuse the scratch space of ctx.
+   The virtual sentinel is used regardless of the options of ctx.
+   errno is that of the scratch directory of ctx when the scratch space
+   cannot be mapped, and EINVAL when the arrays fail the checks of ctx.  */
+int libsa_ctx_build_file (struct libsa_ctx *ctx, const char *input_path,
+                          const char *sa_path, const char *lcp_path);
+int libsa_ctx_build_file64 (struct libsa_ctx *ctx, const char *input_path,
+                            const char *sa_path, const char *lcp_path);
+
+/* An index file holds the suffix array of a text, optionally the lcp array
+   and other arrays derived from the text, each in its own section.  The
+   text itself is not stored, only its length and checksum.
+   The file starts with a header of 4096 bytes, in the byte order of the
+   host that saved the file.
+     offset  size
+          0     8  magic "LIBSAIDX"
+          8     4  version, 1
+         12     4  0x01020304, which reveals the byte order
+         16     4  the size of an element of the arrays, 4 or 8
+         20     4  the number of sections, at most 16
+         24     8  the length of the text
+         32     8  the 64 bit fnv-1a hash of the text
+         40  16*24 the table of sections
+   Each entry of the table of sections is
+          0     4  the id of the section, one of enum libsa_section
+          4     4  reserved, 0
+          8     8  the offset of the section from the start of the file
+         16     8  the size of the section in bytes
+   Each section starts at a multiple of 4096 bytes, which makes every
+   section page aligned in a mapping of the file.  The arrays are stored as
+   they are in memory.
+   No two sections have the same id.  The sections of ids below
+   LIBSA_SECTION_USER are arrays of one element for each character of the
+   text.  The ids from LIBSA_SECTION_USER up are free for the caller, and
+   those sections may be of any size.  */
+enum libsa_section
+{
+    LIBSA_SECTION_SA = 1,
+    LIBSA_SECTION_LCP = 2,
+    /* The inverse suffix array.  */
+    LIBSA_SECTION_ISA = 3,
+    /* llcp and rlcp of libsa_build_lcplr.  */
+    LIBSA_SECTION_LLCP = 4,
+    LIBSA_SECTION_RLCP = 5,
+    LIBSA_SECTION_USER = 256
+};
+
+/* A section to save to an index file.  */
+struct libsa_section_data
+{
+    uint32_t id;
+    const void *data;
+    size_t size;
+};
+
+struct libsa_index;
+
+/* Save the suffix array sa of the len characters of input, and the lcp
+   array lcp unless lcp is null, to an index file at path.
+   Return 0 on success.
+   Return -1 and set errno on failure.  */
+int libsa_index_save (const char *path, const char *input, size_t len,
+                      const int *sa, const int *lcp);
+int libsa_index_save64 (const char *path, const char *input, size_t len,
+                        const int64_t *sa, const int64_t *lcp);
+
+/* Save the nsections sections of sec of the len characters of input to an
+   index file at path.  The elements of the arrays of the sections are width
+   bytes, either sizeof (int) or sizeof (int64_t).
+   Return 0 on success.
+   Return -1 and set errno on failure.  errno is EINVAL when width is
+   neither, when there are more than 16 sections, when two sections have
+   the same id or when the size of an array is not len elements.  */
+int libsa_index_save_sections (const char *path, const char *input,
+                               size_t len, size_t width,
+                               const struct libsa_section_data *sec,
+                               size_t nsections);
+
+/* Open the index file at path.
+   The file is mapped, rather than read, and the arrays of the index point
+   into the mapping.  Opening takes the same time regardless of the size of
+   the index.  The pages of the file are read from disk as they are
+   accessed.
+   Return the index on success.
+   Return null and set errno on failure.  errno is EINVAL when the file is
+   not an index file saved by a host with the same byte order, or when one
+   of its sections is not valid as described above.  */
+struct libsa_index *libsa_index_open (const char *path);
+
+/* Unmap the file of index and free index.  */
+void libsa_index_close (struct libsa_index *index);
+
+/* Return the length of the text of index.  */
+size_t libsa_index_len (const struct libsa_index *index);
+
+/* Return the suffix array or the lcp array of index.
+   Return null if index has no such array or if the elements of the arrays
+   of index are of another type.  */
+const int *libsa_index_sa (const struct libsa_index *index);
+const int *libsa_index_lcp (const struct libsa_index *index);
+const int64_t *libsa_index_sa64 (const struct libsa_index *index);
+const int64_t *libsa_index_lcp64 (const struct libsa_index *index);
+
+/* Return the section of index whose id is id and store its size in bytes to
+   size, unless size is null.
+   Return null if index has no such section.  */
+const void *libsa_index_section (const struct libsa_index *index,
+                                 uint32_t id, size_t *size);
+
+/* Return 0 if input of len characters is the text of index, as far as the
+   length and the checksum can tell.
+   Return -1 otherwise.  */
+int libsa_index_check (const struct libsa_index *index, const char *input,
+                       size_t len);
+
 #ifdef __cplusplus
 }
 #endif
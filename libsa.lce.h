@@ -0,0 +1,185 @@
+/* The longest common extension of two suffixes, by a range minimum query
+   over the lcp array.
+   libsa.c includes this file once for each index type, after libsa.core.h,
+   with the same definitions of saidx_t, saidx_max and SA_.  */
+
+#define scan_min SA_(scan_min)
+#define block_min SA_(block_min)
+
+/* The lcp array is split into blocks of rmq_block elements and the blocks
+   into superblocks of rmq_block blocks.  The minimum of each block is kept
+   in bmin and the minimum of every run of 2^k superblocks in level k of
+   sparse.  A query scans at most two partial blocks of lcp and two partial
+   superblocks of bmin and looks up two elements of sparse, which takes
+   constant time.  bmin and sparse take about 1/2 bit per element of lcp
+   with saidx_t of int.  An inverse suffix array built by libsa_lce_build
+   takes another element of saidx_t per element of lcp.
+   lcp[0] is not read, because no query reaches it.  */
+struct SA_(libsa_lce)
+{
+    const saidx_t *lcp;
+    const saidx_t *isa;
+    saidx_t *own_isa;
+    size_t len;
+    saidx_t *bmin;
+    size_t nblocks;
+    saidx_t *sparse[sizeof (size_t) * CHAR_BIT];
+    int nlevels;
+};
+
+/* Return the smallest of the elements of a from x to y, inclusive.  */
+static saidx_t
+scan_min (const saidx_t *a, size_t x, size_t y)
+{
+    saidx_t m = a[x];
+
+    for (++x; x <= y; ++x)
+      if (a[x] < m)
+        m = a[x];
+    return m;
+}
+
+/* Return the smallest minimum of the blocks of lce from x to y,
+   inclusive.  */
+static saidx_t
+block_min (const struct SA_(libsa_lce) *lce, size_t x, size_t y)
+{
+    const size_t sx = x / rmq_block, sy = y / rmq_block;
+    saidx_t m, t;
+
+    if (sx == sy)
+      return scan_min (lce->bmin, x, y);
+    m = scan_min (lce->bmin, x, (sx + 1) * rmq_block - 1);
+    t = scan_min (lce->bmin, sy * rmq_block, y);
+    if (t < m)
+      m = t;
+    if (sy - sx > 1)
+      {
+        const int k = floor_log2 (sy - sx - 1);
+        const saidx_t *s = lce->sparse[k];
+        const size_t z = sy - ((size_t) 1 << k);
+
+        t = s[sx+1] < s[z] ? s[sx+1] : s[z];
+        if (t < m)
+          m = t;
+      }
+    return m;
+}
+
+struct SA_(libsa_lce) *
+SA_(libsa_lce_build) (const saidx_t *sa, const saidx_t *lcp,
+                      const saidx_t *isa, size_t len)
+{
+    struct SA_(libsa_lce) *lce = alloc (sizeof *lce);
+    size_t k, nsuper;
+    int lvl;
+
+    memset (lce, 0, sizeof *lce);
+    lce->lcp = lcp;
+    lce->len = len;
+    lce->isa = isa;
+    if (!isa)
+      {
+        lce->own_isa = alloc (len * sizeof *lce->own_isa);
+        for (k = 0; k < len; ++k)
+          lce->own_isa[sa[k]] = k;
+        lce->isa = lce->own_isa;
+      }
+    if (len < 2)
+      return lce;
+
+    lce->nblocks = (len + rmq_block - 1) / rmq_block;
+    lce->bmin = alloc (lce->nblocks * sizeof *lce->bmin);
+    for (k = 0; k < lce->nblocks; ++k)
+      {
+        const size_t end = (k + 1) * rmq_block;
+        lce->bmin[k] = scan_min (lcp, k > 0 ? k * rmq_block : 1,
+                                 (end < len ? end : len) - 1);
+      }
+    nsuper = (lce->nblocks + rmq_block - 1) / rmq_block;
+    lce->sparse[0] = alloc (nsuper * sizeof *lce->sparse[0]);
+    for (k = 0; k < nsuper; ++k)
+      {
+        const size_t end = (k + 1) * rmq_block;
+        lce->sparse[0][k] = scan_min (lce->bmin, k * rmq_block,
+                                      (end < lce->nblocks ? end
+                                                          : lce->nblocks) - 1);
+      }
+    for (lvl = 1; ((size_t) 1 << lvl) <= nsuper; ++lvl)
+      {
+        const size_t half = (size_t) 1 << (lvl - 1);
+        const saidx_t *prev = lce->sparse[lvl-1];
+        saidx_t *s = alloc ((nsuper - 2 * half + 1) * sizeof *s);
+
+        for (k = 0; k + 2 * half <= nsuper; ++k)
+          s[k] = prev[k] < prev[k+half] ? prev[k] : prev[k+half];
+        lce->sparse[lvl] = s;
+      }
+    lce->nlevels = lvl;
+    return lce;
+}
+
+void
+SA_(libsa_lce_destroy) (struct SA_(libsa_lce) *lce)
+{
+    int lvl;
+
+    if (!lce)
+      return;
+    for (lvl = 0; lvl < lce->nlevels; ++lvl)
+      free (lce->sparse[lvl]);
+    free (lce->bmin);
+    free (lce->own_isa);
+    free (lce);
+}
+
+saidx_t
+SA_(libsa_lce_rmq) (const struct SA_(libsa_lce) *lce, size_t x, size_t y)
+{
+    const size_t bx = x / rmq_block, by = y / rmq_block;
+    saidx_t m, t;
+
+    assert (0 < x && x <= y && y < lce->len);
+    if (bx == by)
+      return scan_min (lce->lcp, x, y);
+    m = scan_min (lce->lcp, x, (bx + 1) * rmq_block - 1);
+    t = scan_min (lce->lcp, by * rmq_block, y);
+    if (t < m)
+      m = t;
+    if (by - bx > 1)
+      {
+        t = block_min (lce, bx + 1, by - 1);
+        if (t < m)
+          m = t;
+      }
+    return m;
+}
+
+size_t
+SA_(libsa_lce) (const struct SA_(libsa_lce) *lce, size_t i, size_t j)
+{
+    size_t x, y;
+
+    assert (i < lce->len && j < lce->len);
+    if (i == j)
+      return lce->len - i;
+    x = lce->isa[i];
+    y = lce->isa[j];
+    if (x > y)
+      {
+        const size_t t = x;
+        x = y;
+        y = t;
+      }
+    return SA_(libsa_lce_rmq) (lce, x + 1, y);
+}
+
+#undef scan_min
+#undef block_min
+
+/* Copyright (c) 2025 Dmitry Goncharov
+ * dgoncharov@users.sf.net.
+ *
+ * Distributed under GPL v2 or the BSD License (see accompanying file copying),
+ * your choice.
+ */
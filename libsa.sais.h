@@ -0,0 +1,1592 @@
+/* The sais algorithm over the input of one symbol type.
+   libsa.core.h includes this file once for each symbol type of each index
+   type.  Before each inclusion libsa.core.h defines
+   sym_t, the type of the elements of the input,
+   SYM_(name), which gives each function of this file a name unique to the
+   index type and the symbol type,
+   build_red, the build of the reduced input, whose symbols are of saidx_t,
+   and
+   SAIS_INPUT, when sym_t is the type of the input of the library, rather
+   than the type of the reduced input.  Only the input of the library has
+   the top level functions of this file.  */
+
+#define print_input SYM_(print_input)
+#define print_sa SYM_(print_sa)
+#define sufcmp SYM_(sufcmp)
+#define sorted SYM_(sorted)
+#define all_sorted SYM_(all_sorted)
+#define lms_blocks_differ SYM_(lms_blocks_differ)
+#define reduce SYM_(reduce)
+#define insert_lms SYM_(insert_lms)
+#define insert_sorted_lms SYM_(insert_sorted_lms)
+#define prefetch SYM_(prefetch)
+#define induce_l_par SYM_(induce_l_par)
+#define induce_s_par SYM_(induce_s_par)
+#define induce_l SYM_(induce_l)
+#define induce_s SYM_(induce_s)
+#define naive_lcp SYM_(naive_lcp)
+#define lms_lcp SYM_(lms_lcp)
+#define induce_l_lcp SYM_(induce_l_lcp)
+#define induce_s_lcp SYM_(induce_s_lcp)
+#define induce_lcp SYM_(induce_lcp)
+#define classify_par SYM_(classify_par)
+#define classify SYM_(classify)
+#define init_level SYM_(init_level)
+#define sort_lms SYM_(sort_lms)
+#define induce_sorted SYM_(induce_sorted)
+#define build SYM_(build)
+#define last_smallest SYM_(last_smallest)
+#define alphabet_size SYM_(alphabet_size)
+#define verify SYM_(verify)
+#define phi_lcp SYM_(phi_lcp)
+#define build_top SYM_(build_top)
+#define compact_ws_size SYM_(compact_ws_size)
+#define compact_input SYM_(compact_input)
+#define ctx_build SYM_(ctx_build)
+
+/* Print len elements of input either as character or integers.  */
+static void
+print_input (const struct libsa_ctx *ctx, const sym_t *input, size_t len, int ascii, int depth)
+{
+    size_t k;
+
+    if (!ctx->log)
+      return;
+
+    print (ctx, "%*s", depth, "");
+    for (k = 0; k < len; ++k)
+      if (ascii && input[k] > 31 && input[k] < 127)
+        print (ctx, " %c ", (char) input[k]);
+      else
+        print (ctx, " %lld ", (long long) input[k]);
+    print (ctx, "\n");
+}
+
+/* Pretty print a table that contains input, type, lms, suffix array and buckets
+   along with the index of each element.  */
+static void
+print_sa (const struct libsa_ctx *ctx, const saidx_t *result, const sym_t *input,
+          const uint64_t *type, const saidx_t *buckets, size_t len, int depth)
+{
+    size_t k;
+    saidx_t prior = 0;
+    const int ascii = depth == 0;
+
+    if (!ctx->log)
+      return;
+
+    print (ctx, "\n%*sindex  ", depth, "");
+    for (k = 0; k < len; ++k)
+      print (ctx, "%2lu ", k);
+    print (ctx, "\n%*sinput  ", depth, "");
+    print_input (ctx, input, len, depth == 0, 0);
+    print (ctx, "%*stype   ", depth, "");
+    for (k = 0; k < len; ++k)
+      if (ltype (type, k))
+        print (ctx, " L ");
+      else
+        print (ctx, " S ");
+    print (ctx, "\n%*slms       ", depth, "");
+    for (k = 1; k < len; ++k)
+      if (is_lms (type, k))
+        print (ctx, " ^ ");
+      else
+        print (ctx, "   ");
+    print (ctx, "\n%*ssufar  ", depth, "");
+    for (k = 0; k < len; ++k)
+      print (ctx, "%2lld ", (long long) result[k]);
+
+
+    print (ctx, "\n%*sbucke | 0|", depth, "");
+    for (k = 1; k < len; ++k)
+      {
+        /* buckets[x-1] is the beginning of the bucket for character x.
+           buckets[x]-1 is the end of the bucket for character x.
+           result is sorted, therefore a bucket is printed when its first
+           element is met.  */
+        const saidx_t pos = result[k];
+        if (pos < 0)
+          continue;
+        const saidx_t c = input[pos];
+        const saidx_t beg = c ? buckets[c-1] : 0;
+        const saidx_t end = buckets[c] - 1;
+        if (c == prior)
+          continue;
+        prior = c;
+        if (ascii && c > 31 && c < 127)
+          print (ctx, "%2c%*s|", (unsigned char) c, (int) (3*(end - beg)), "");
+        else
+          print (ctx, "%2lld%*s|", (long long) c, (int) (3*(end - beg)), "");
+      }
+    print (ctx, "\n\n");
+}
+
+#ifndef NDEBUG
+/* Compare the suffixes of input of len elements that begin at x and y.
+   A suffix that is a prefix of the other suffix is smaller, which is the
+   order of the suffixes of input with either a real or a virtual sentinel.
+   Return -1 if suffix x < suffix y.
+   Return 1 if suffix x > suffix y.
+   Return 0 if suffix x == suffix y.  */
+static int
+sufcmp (const sym_t *input, size_t len, size_t x, size_t y)
+{
+    for (; x < len && y < len; ++x, ++y)
+      {
+        if (input[x] > input[y])
+          return 1;
+        if (input[x] < input[y])
+          return -1;
+      }
+    if (x < len)
+      return 1;
+    if (y < len)
+      return -1;
+    return 0;
+}
+
+/* Check that the initialized elements of result are sorted.
+   Return 1 on success. Return 0 on failure.  */
+static int
+sorted (const saidx_t *result, const sym_t *input, size_t len, int depth)
+{
+    size_t k;
+    (void) depth;
+
+    for (k = 1; k < len; ++k)
+      {
+        saidx_t pos, pos1;
+        while (k < len && result[k-1] < 0)
+          ++k;
+        pos = result[k-1];
+        if (k >= len)
+          break;
+        assert (pos >= 0);
+        while (k < len && result[k] < 0)
+          ++k;
+        if (k >= len)
+          break;
+        pos1 = result[k];
+        assert (pos1 >= 0);
+        if (sufcmp (input, len, pos, pos1) >= 0)
+          {
+            assert (0);
+            return 0;
+          }
+      }
+    return 1;
+}
+
+/* Check that the first n elements of result are initialized and sorted.
+   Return 1 on success. Return 0 on failure.  */
+static int
+all_sorted (const saidx_t *result, size_t n, const sym_t *input, size_t len,
+            int depth)
+{
+    size_t k;
+    (void) depth;
+
+    for (k = 1; k < n; ++k)
+      {
+        const saidx_t pos = result[k-1], pos1 = result[k];
+        assert (pos >= 0);
+        assert (pos1 >= 0);
+        if (sufcmp (input, len, pos, pos1) >= 0)
+          {
+            assert (0);
+            return 0;
+          }
+      }
+    return 1;
+}
+
+#endif
+
+/* Compare the lms block starting at position 'x' with the lms block at
+   position 'y'. The lms blocks in 'input' are supposed to be sorted, even
+   though equal lms blocks may still need to be swapped. The lms block at
+   position 'x' <= the lms block at 'y'.
+   Return 0 if the lengths of the blocks match and values and types match
+   character for character for all characters.
+   Return 1 otherwise.  */
+static int
+lms_blocks_differ (const sym_t *input, const uint64_t *type, size_t len,
+                   saidx_t x, saidx_t y)
+{
+    (void) len;
+    if (x < 0)
+      return 1;
+    assert (x > 0);
+    assert ((size_t) x < len);
+    assert (y > 0);
+    assert ((size_t) y < len);
+
+    /* An infinite loop here is correct.
+       If the blocks differ, then one of the returns below in the loop returns 1.
+       If the blocks are equal, then 0 is returned from the loop below.
+       If one of the blocks is the last lms of the null terminator, then the
+       blocks differ, because the last lms block is unique.
+       The same is true of a block that ends at the virtual sentinel, which
+       follows the last position of input.  */
+    for (;;)
+      if ((size_t) x + 1 == len || (size_t) y + 1 == len)
+        /* One of the blocks ends at the virtual sentinel.  */
+        return 1;
+      else if (input[x] != input[y])
+        /* Values differ.  */
+        return 1;
+      else if (ltype (type, x) != ltype (type, y))
+        /* Types differ.  */
+        return 1;
+      else if (ltype (type, x) && !ltype (type, x+1)
+               && ltype (type, y) && !ltype (type, y+1))
+        /* The blocks are of the same length.
+           y+1 and x+1 are the ends of the respective blocks.  */
+        return input[x+1] != input[y+1];
+      else
+        ++y, ++x, assert ((size_t) y < len), assert ((size_t) x < len);
+}
+
+/* Give each lms block a name.
+   Give the same name to the lms blocks equal according to lms_blocks_differ.
+   When reduce is called lms blocks are supposed to be sorted in result.
+   reduce moves the sorted lms positions to the first lmslen elements of result
+   and stores the names of the lms blocks, in the order of the lms positions
+   in input, in the last lmslen elements of result.
+   The two ranges do not overlap, because lmslen <= len / 2.
+   When virt is not 0, the sentinel of input is virtual and is not one of
+   the lmslen lms positions.  The sentinel of the reduced input is then
+   virtual as well.  Name 0, which is the name of the sentinel, is not used
+   by any lms block.
+   Return the size of the reduced alphabet.  */
+static size_t
+reduce (const struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+        const uint64_t *type, size_t len, size_t lmslen, int virt, int depth)
+{
+    size_t k, j;
+    size_t abclen = 0;
+    saidx_t prior = -1;
+
+    print (ctx, "%*sreducing ", depth, "");
+    print_input (ctx, input, len, depth == 0, 0);
+    /* Move the sorted lms positions to the front of result.  */
+    for (k = 0, j = 0; k < len; ++k)
+      {
+        const saidx_t pos = result[k];
+        if (pos > 0 && is_lms (type, pos))
+          result[j++] = pos;
+      }
+    assert (j == lmslen);
+    assert (virt || result[0] == (saidx_t) len - 1);
+
+    /* Any two lms positions are at least 2 apart.  This allows to store the
+       name of the lms block at pos in result[lmslen + pos / 2].
+       The sentinel gets name 0.  */
+    memset (result + lmslen, -1, (len - lmslen) * sizeof *result);
+    if (!virt)
+      result[lmslen + (len - 1) / 2] = abclen;
+    for (k = !virt; k < lmslen; ++k)
+      {
+        const saidx_t pos = result[k];
+        abclen += lms_blocks_differ (input, type, len, prior, pos);
+        result[lmslen + pos / 2] = abclen;
+        prior = pos;
+      }
+
+    /* Move the names to the back of result.  */
+    for (k = len, j = len; k > lmslen; --k)
+      if (result[k-1] >= 0)
+        result[--j] = result[k-1];
+    assert (j == len - lmslen);
+
+    ++abclen;
+    print (ctx, "%*sreduced abclen = %zu, lmslen = %zu\n", depth, "", abclen,
+           lmslen);
+    print (ctx, "%*sreduced lms names ", depth, "");
+    print_array (ctx, result + len - lmslen, lmslen, 0, 0);
+    return abclen;
+}
+
+/* Insert the indices of all lms positions of input to the ends of their
+   respective buckets.
+   b is scratch space of abclen elements.  */
+static void
+insert_lms (const struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+            const uint64_t *type, const saidx_t *buckets, saidx_t *b,
+            size_t len, size_t abclen, int depth)
+{
+    size_t k;
+
+    print (ctx, "%*sinserting lms positions\n", depth, "");
+    memset (result, -1, len * sizeof *result);
+    memcpy (b, buckets, abclen * sizeof *b);
+    for (k = len - 1; k > 0; --k)
+      if (is_lms (type, k))
+        result[--b[input[k]]] = k;
+}
+
+/* Move the lmslen sorted lms positions from the front of result to the ends of
+   their respective buckets.
+   b is scratch space of abclen elements.  */
+static void
+insert_sorted_lms (const struct libsa_ctx *ctx, saidx_t *result,
+                   const sym_t *input, const saidx_t *buckets, saidx_t *b,
+                   size_t len, size_t lmslen, size_t abclen, int depth)
+{
+    size_t k;
+
+    print (ctx, "%*sinserting sorted lms positions\n", depth, "");
+    memset (result + lmslen, -1, (len - lmslen) * sizeof *result);
+    memcpy (b, buckets, abclen * sizeof *b);
+    /* The k-th smallest lms position goes to index k or greater in result.
+       Moving the positions from the greatest to the smallest therefore
+       never overwrites a position that is not moved yet.  */
+    for (k = lmslen; k > 0; --k)
+      {
+        const saidx_t inidx = result[k-1]; /* Index in the input string.  */
+        result[k-1] = -1;
+        result[--b[input[inidx]]] = inidx;
+      }
+}
+
+/* Prefetch the character and the type of position pos - 1, which the
+   element of result that holds pos induces.
+   The accesses of induce_l and induce_s to input and type are at random
+   positions and each of them is a cache miss on a large input.  Prefetching
+   them prefetch_distance elements ahead overlaps the misses.
+   The elements ahead may change before they are scanned, in which case the
+   prefetch is wasted, but harmless.  */
+static void
+prefetch (const sym_t *input, const uint64_t *type, saidx_t pos)
+{
+    if (pos <= 0)
+      return;
+    __builtin_prefetch (input + pos - 1);
+    __builtin_prefetch (type + (pos - 1) / type_bits);
+}
+
+/* Induce the indices of L type positions from lms positions on
+   ctx->nthreads threads.
+   result is processed in blocks of induce_block elements.  For each block
+   the threads first read the block along with the characters that the block
+   induces.  The reads of input and type at random positions are the
+   expensive part of induce_l, and this is the part that runs in parallel.
+   Then one thread induces the L positions of the block.  An element of the
+   block that has been written after the block was read is read again.
+   The positions induced past the end of the block are buffered and written
+   by all threads after the block is done.
+   b is initialized by the caller, as described in induce_l.  */
+static void
+induce_l_par (struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+              const uint64_t *type, saidx_t *b, size_t len)
+{
+    saidx_t *val, *chr, *widx, *wpos;
+    saidx_t beg;
+    const saidx_t slen = len;
+
+    val = ws_alloc (&ctx->ws, 4 * induce_block * sizeof *val);
+    chr = val + induce_block;
+    widx = chr + induce_block;
+    wpos = widx + induce_block;
+    for (beg = 0; beg < slen; beg += induce_block)
+      {
+        const saidx_t end = slen - beg > induce_block ? beg + induce_block : slen;
+        saidx_t k, nw;
+
+#pragma omp parallel for num_threads(ctx->nthreads) schedule(static)
+        for (k = beg; k < end; ++k)
+          {
+            const saidx_t pos = result[k];
+            val[k-beg] = pos;
+            chr[k-beg] = pos > 0 && ltype (type, pos-1)
+                         ? (saidx_t) input[pos-1] : -1;
+          }
+
+        for (k = beg, nw = 0; k < end; ++k)
+          {
+            saidx_t c; /* L type character that this iteration is inserting.  */
+            saidx_t bidx; /* The bucket index of the character that this iteration is inserting.  */
+            const saidx_t pos = result[k]; /* Position in the suffix array.  */
+            if (pos == val[k-beg])
+              c = chr[k-beg];
+            else
+              c = pos > 0 && ltype (type, pos-1)
+                  ? (saidx_t) input[pos-1] : -1;
+            if (c < 0)
+              continue;
+            bidx = b[c];
+            ++b[c]; /* Advance bucket head.  */
+            if (bidx < end)
+              result[bidx] = pos - 1;
+            else
+              {
+                widx[nw] = bidx;
+                wpos[nw] = pos - 1;
+                ++nw;
+              }
+          }
+
+#pragma omp parallel for num_threads(ctx->nthreads) schedule(static)
+        for (k = 0; k < nw; ++k)
+          result[widx[k]] = wpos[k];
+      }
+    ws_free (&ctx->ws, val);
+}
+
+/* Induce the indices of S type positions from the L type positions on
+   ctx->nthreads threads.
+   This is the same as induce_l_par, except that the blocks are processed from
+   right to left.
+   b is initialized by the caller.
+   bwt is the same as that of induce_s.  */
+static void
+induce_s_par (struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+              const uint64_t *type, saidx_t *b, size_t len, sym_t *bwt)
+{
+    saidx_t *val, *chr, *widx, *wpos;
+    saidx_t beg, end;
+    int shift = 0;
+
+    val = ws_alloc (&ctx->ws, 4 * induce_block * sizeof *val);
+    chr = val + induce_block;
+    widx = chr + induce_block;
+    wpos = widx + induce_block;
+    for (end = len; end > 0; end = beg)
+      {
+        saidx_t k, nw;
+
+        beg = end > induce_block ? end - induce_block : 0;
+#pragma omp parallel for num_threads(ctx->nthreads) schedule(static)
+        for (k = beg; k < end; ++k)
+          {
+            const saidx_t pos = result[k];
+            val[k-beg] = pos;
+            chr[k-beg] = pos > 0 && !ltype (type, pos-1)
+                         ? (saidx_t) input[pos-1] : -1;
+          }
+
+        for (k = end - 1, nw = 0; k >= beg; --k)
+          {
+            saidx_t c; /* S type character that this iteration is inserting.  */
+            saidx_t bidx; /* The bucket index of the character that this iteration is inserting.  */
+            const saidx_t pos = result[k]; /* Position in the suffix array.  */
+            if (bwt)
+              {
+                if (pos == 0)
+                  {
+                    shift = 1;
+                    ctx->primary = k + 1;
+                  }
+                else
+                  bwt[k+shift] = input[pos-1];
+              }
+            if (pos == val[k-beg])
+              c = chr[k-beg];
+            else
+              c = pos > 0 && !ltype (type, pos-1)
+                  ? (saidx_t) input[pos-1] : -1;
+            if (c < 0)
+              continue;
+            bidx = b[c] - 1;
+            --b[c]; /* Retreat bucket tail.  */
+            /* This overwrites the lms characters inserted earlier.  */
+            if (bidx >= beg)
+              result[bidx] = pos - 1;
+            else
+              {
+                widx[nw] = bidx;
+                wpos[nw] = pos - 1;
+                ++nw;
+              }
+          }
+
+#pragma omp parallel for num_threads(ctx->nthreads) schedule(static)
+        for (k = 0; k < nw; ++k)
+          result[widx[k]] = wpos[k];
+      }
+    ws_free (&ctx->ws, val);
+}
+
+/* Induce the indices of L type positions from lms positions.
+   When virt is not 0, the sentinel of input is virtual.  The virtual
+   sentinel is the smallest suffix and induces position len - 1, which is L
+   type, before any other position.
+   b is scratch space of abclen + 1 elements.  b[c] is the head of the bucket
+   of character c, which is the end of the bucket of c - 1.  This allows
+   character 0 to be L type when the sentinel is virtual.  */
+static void
+induce_l (struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+          const uint64_t *type, const saidx_t *buckets, saidx_t *b,
+          size_t len, size_t abclen, int virt, int depth)
+{
+    size_t k;
+
+    print (ctx, "%*sinducing L positions from lms pos\n", depth, "");
+    b[0] = 0;
+    memcpy (b + 1, buckets, abclen * sizeof *b);
+    if (virt)
+      result[b[input[len-1]]++] = len - 1;
+    if (ctx->nthreads > 1 && len > induce_block)
+      {
+        induce_l_par (ctx, result, input, type, b, len);
+        assert_full (ctx, unique (result, len));
+        return;
+      }
+    /* Induce L positions from lms positions.
+       Scan from left to right.
+       If pos is L type, then put pos to the beginning of the bucket.  */
+    for (k = 0; k < len; ++k)
+      {
+        saidx_t c; /* L type character that this iteration is inserting.  */
+        saidx_t bidx; /* The bucket index of the character that this iteration is inserting.  */
+        saidx_t pos = result[k]; /* Position in the suffix array.  */
+        if (k + prefetch_distance < len)
+          prefetch (input, type, result[k+prefetch_distance]);
+        if (pos <= 0)
+          continue;
+        --pos;
+        if (!ltype (type, pos))
+          /* S character.  */
+          continue;
+        c = input[pos];
+        bidx = b[c];
+        ++b[c]; /* Advance bucket head.  */
+        result[bidx] = pos;
+      }
+    assert_full (ctx, unique (result, len));
+}
+
+/* Induce the indices of S type positions from the L type positions.
+   b is scratch space of abclen elements.
+   When bwt is not null, also store the bwt of input, whose sentinel is
+   virtual, to bwt and its primary index to ctx->primary.  The index of
+   each position in result is final when the scan from right to left
+   reaches it, which lets the scan emit the bwt as it goes, rather than in a
+   separate pass over result.  bwt[0] is stored by the caller.  */
+static void
+induce_s (struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+          const uint64_t *type, const saidx_t *buckets, saidx_t *b,
+          size_t len, size_t abclen, sym_t *bwt, int depth)
+{
+    saidx_t k;
+    int shift = 0;
+
+    print (ctx, "%*sinducing S positions from L positions\n", depth, "");
+    memcpy (b, buckets, abclen * sizeof *b);
+    if (ctx->nthreads > 1 && len > induce_block)
+      {
+        induce_s_par (ctx, result, input, type, b, len, bwt);
+        assert_full (ctx, unique (result, len));
+        return;
+      }
+    /* Induce S positions from L positions.
+       Scan from right to left.
+       If pos is S type, then put pos to the back of the bucket.  */
+    for (k = len - 1; k >= 0; --k)
+      {
+        saidx_t c; /* S type character that this iteration is inserting.  */
+        saidx_t bidx; /* The bucket index of the character that this iteration is inserting.  */
+        saidx_t pos = result[k]; /* Position in the suffix array.  */
+        if (k >= prefetch_distance)
+          prefetch (input, type, result[k-prefetch_distance]);
+        if (bwt)
+          {
+            /* The sentinel precedes the suffix at 0 and takes no element
+               of bwt.  The row of the suffix of the sentinel comes first
+               and takes bwt[0].  */
+            if (pos == 0)
+              {
+                shift = 1;
+                ctx->primary = k + 1;
+              }
+            else
+              bwt[k+shift] = input[pos-1];
+          }
+        if (pos <= 0)
+          continue;
+        --pos;
+        if (ltype (type, pos))
+          /* L character.  */
+          continue;
+        c = input[pos];
+        bidx = b[c] - 1;
+        --b[c]; /* Retreat bucket tail.  */
+        /* This overwrites the lms characters inserted earlier.  */
+        result[bidx] = pos;
+      }
+    assert_full (ctx, unique (result, len));
+}
+
+/* The induced lcp algorithm.
+   See "Inducing the LCP-Array" by Johannes Fischer for the description of
+   this algorithm.
+   The lcp values of the sorted lms suffixes are computed first.  Then
+   induce_l_lcp and induce_s_lcp compute the lcp value of each suffix, as they
+   place the suffix, from the lcp values between the two suffixes that
+   induced the suffix and its neighbour in the bucket.  */
+
+/* Return the length of the longest common prefix of the suffixes of input
+   that begin at x and y.  */
+static saidx_t
+naive_lcp (const sym_t *input, saidx_t x, saidx_t y)
+{
+    saidx_t l = 0;
+
+    /* The unique last character of input stops this loop.  */
+    while (input[x+l] == input[y+l])
+      ++l;
+    return l;
+}
+
+/* Compute the lcp values of the lmslen sorted lms suffixes at the front of
+   result.
+   Return an array of lmslen elements allocated from the workspace of ctx.
+   The k-th element of the array is the lcp of the k-th smallest lms suffix
+   and the (k-1)-th smallest lms suffix.
+   lcp is scratch space of len elements.
+   This is the phi algorithm restricted to lms suffixes.  The lcp value of
+   the previous lms suffix, less the distance between the two suffixes, is
+   reused when it is a lower bound, which is when the position at the same
+   distance from the predecessor of the previous suffix is also lms.  */
+static saidx_t*
+lms_lcp (struct libsa_ctx *ctx, saidx_t *lcp, const saidx_t *result,
+         const sym_t *input, const uint64_t *type, size_t len, size_t lmslen,
+         int depth)
+{
+    saidx_t *r;
+    saidx_t prev, prevphi, l;
+    size_t k;
+
+    print (ctx, "%*scomputing lcp of lms positions\n", depth, "");
+    r = ws_alloc (&ctx->ws, lmslen * sizeof *r);
+    /* Store phi of each lms position in lcp.  */
+    lcp[result[0]] = -1;
+    for (k = 1; k < lmslen; ++k)
+      lcp[result[k]] = result[k-1];
+    /* Walk lms positions from left to right and replace phi with plcp.  */
+    for (k = 1, prev = -1, prevphi = -1, l = 0; k < len; ++k)
+      {
+        saidx_t q, x;
+
+        if (!is_lms (type, k))
+          continue;
+        q = lcp[k];
+        x = prevphi + (saidx_t) k - prev;
+        if (q < 0 || prevphi < 0 || l <= (saidx_t) k - prev
+            || !is_lms (type, x))
+          l = 0;
+        else
+          l -= k - prev;
+        if (q >= 0)
+          l += naive_lcp (input + l, k, q);
+        lcp[k] = l;
+        prev = k;
+        prevphi = q;
+      }
+    r[0] = 0;
+    for (k = 1; k < lmslen; ++k)
+      r[k] = lcp[result[k]];
+    return r;
+}
+
+/* The same as induce_l, except that induce_l_lcp also stores in lcp the lcp
+   value of each L position it inserts.
+   Before the call lcp holds the lcp values of the lms positions, relative to
+   the previous lms position.
+   b is scratch space of abclen + 1 elements with the same layout as in
+   induce_l.
+   last and stack are scratch space of abclen and len elements.
+   stack holds the indices of those scanned elements of result whose lcp
+   values are smaller than the lcp value of any element scanned after them.
+   The minimum of lcp between a scanned element and the current one is then
+   found by a binary search of stack.  */
+static void
+induce_l_lcp (const struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+              const sym_t *input, const uint64_t *type,
+              const saidx_t *buckets, saidx_t *b, saidx_t *last,
+              saidx_t *stack, size_t len, size_t abclen, int depth)
+{
+    size_t k, top = 0;
+    saidx_t prevk = -1; /* The index of the previous scanned element.  */
+
+    print (ctx, "%*sinducing L positions and lcp from lms pos\n", depth, "");
+    b[0] = 0;
+    memcpy (b + 1, buckets, abclen * sizeof *b);
+    /* last[c] is the index of the element which induced the previous L
+       position of bucket c.  */
+    memset (last, -1, abclen * sizeof *last);
+    for (k = 0; k < len; ++k)
+      {
+        saidx_t c, bidx, lo, hi;
+        saidx_t pos = result[k];
+
+        if (pos < 0)
+          continue;
+        if (!ltype (type, pos)
+            && (prevk < 0 || ltype (type, result[prevk])
+                || input[result[prevk]] != input[pos]))
+          /* The first lms position of its bucket.
+             The previous element is either the last L position of the
+             bucket or belongs to another bucket.  */
+          lcp[k] = prevk >= 0 && input[result[prevk]] == input[pos]
+                   ? naive_lcp (input, result[prevk], pos) : 0;
+        top = stack_push (stack, top, lcp, k);
+        prevk = k;
+        if (pos == 0 || !ltype (type, pos-1))
+          continue;
+        --pos;
+        c = input[pos];
+        bidx = b[c];
+        ++b[c]; /* Advance bucket head.  */
+        result[bidx] = pos;
+        if (last[c] < 0)
+          /* The first position of the bucket.  */
+          lcp[bidx] = 0;
+        else
+          {
+            /* Find the lowest element of stack above last[c].  */
+            for (lo = 0, hi = top - 1; lo < hi;)
+              {
+                const saidx_t mid = (lo + hi) / 2;
+                if (stack[mid] > last[c])
+                  hi = mid;
+                else
+                  lo = mid + 1;
+              }
+            lcp[bidx] = lcp[stack[lo]] + 1;
+          }
+        last[c] = k;
+      }
+}
+
+/* The same as induce_s, except that induce_s_lcp also stores in lcp the lcp
+   value of each S position it inserts.
+   sstart[c] is the index of the first S position of bucket c.
+   last and stack are scratch space of abclen and len elements.  */
+static void
+induce_s_lcp (const struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+              const sym_t *input, const uint64_t *type,
+              const saidx_t *buckets, saidx_t *b, const saidx_t *sstart,
+              saidx_t *last, saidx_t *stack, size_t len, size_t abclen,
+              int depth)
+{
+    saidx_t k;
+    size_t top = 0;
+
+    print (ctx, "%*sinducing S positions and lcp from L positions\n", depth, "");
+    memcpy (b, buckets, abclen * sizeof *b);
+    memset (last, -1, abclen * sizeof *last);
+    for (k = len - 1; k >= 0; --k)
+      {
+        saidx_t c, bidx, lo, hi;
+        saidx_t pos = result[k];
+
+        /* lcp[k+1] is final by now.  */
+        if ((size_t) k + 1 < len)
+          top = stack_push (stack, top, lcp, k + 1);
+        if (pos <= 0 || ltype (type, pos-1))
+          continue;
+        --pos;
+        c = input[pos];
+        assert (c > 0);
+        bidx = --b[c];
+        result[bidx] = pos;
+        if (last[c] >= 0)
+          {
+            /* Find the lowest element of stack at or below last[c].  */
+            for (lo = 0, hi = top - 1; lo < hi;)
+              {
+                const saidx_t mid = (lo + hi) / 2;
+                if (stack[mid] <= last[c])
+                  hi = mid;
+                else
+                  lo = mid + 1;
+              }
+            lcp[bidx+1] = lcp[stack[lo]] + 1;
+          }
+        last[c] = k;
+        if (bidx == sstart[c])
+          /* The first S position of the bucket.  */
+          lcp[bidx] = bidx > (c ? buckets[c-1] : 0)
+                      ? naive_lcp (input, result[bidx-1], pos) : 0;
+      }
+}
+
+/* Induce L and S positions from the sorted lms positions, which are already
+   in their buckets, and store the lcp array in lcp.
+   lmslcp holds the lcp values of the lmslen sorted lms positions, as returned
+   by lms_lcp.  induce_lcp releases lmslcp.  */
+static void
+induce_lcp (struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+            saidx_t *lmslcp, const sym_t *input, const uint64_t *type,
+            const saidx_t *buckets, saidx_t *b, size_t len, size_t abclen,
+            int depth)
+{
+    saidx_t *last, *sstart, *stack;
+    size_t k, n;
+
+    for (k = 0, n = 0; k < len; ++k)
+      if (result[k] >= 0)
+        lcp[k] = lmslcp[n++];
+    last = ws_alloc (&ctx->ws, abclen * sizeof *last);
+    sstart = ws_alloc (&ctx->ws, abclen * sizeof *sstart);
+    stack = ws_alloc (&ctx->ws, len * sizeof *stack);
+    memcpy (sstart, buckets, abclen * sizeof *sstart);
+    for (k = 0; k < len; ++k)
+      if (!ltype (type, k))
+        --sstart[input[k]];
+    induce_l_lcp (ctx, result, lcp, input, type, buckets, b, last, stack, len,
+                  abclen, depth);
+    induce_s_lcp (ctx, result, lcp, input, type, buckets, b, sstart, last,
+                  stack, len, abclen, depth);
+    print (ctx, "%*slcp    ", depth, "");
+    print_array (ctx, lcp, len, 0, 0);
+    ws_free (&ctx->ws, lmslcp);
+}
+
+/* Store the type of each position of input in type and the number of times
+   each character occurs in input in buckets, which is zero initialized.
+   The work is split among ctx->nthreads threads.
+   Each thread classifies a chunk of input from right to left.  A chunk is a
+   whole number of words of type, which keeps the threads from writing to
+   the same word.  The last positions of a chunk that are equal to the first
+   character of the next chunk get the type of the next chunk, which is not
+   known yet.  These positions are left S type and the beginning of their
+   run is stored in run.  Then the chunks are walked from right to left to
+   make the runs that precede an L position L type.
+   Return the number of lms positions.  */
+static size_t
+classify_par (struct libsa_ctx *ctx, uint64_t *type, saidx_t *buckets,
+              const sym_t *input, size_t len, size_t abclen, int virt)
+{
+    const int n = ctx->nthreads;
+    const size_t chunk = type_words ((len + n - 1) / n) * type_bits;
+    saidx_t *counts = 0;
+    size_t *run;
+    saidx_t lmslen = 0, k;
+    const saidx_t slen = len;
+    int c;
+
+    run = ws_alloc (&ctx->ws, n * sizeof *run);
+    /* Count the characters of a large alphabet on one thread, rather than
+       allocate counts of every character for every thread.  */
+    if (abclen <= classify_abclen)
+      {
+        counts = ws_alloc (&ctx->ws, n * abclen * sizeof *counts);
+        memset (counts, 0, n * abclen * sizeof *counts);
+      }
+
+#pragma omp parallel for num_threads(n) schedule(static)
+    for (c = 0; c < n; ++c)
+      {
+        const size_t beg = c * chunk < len ? c * chunk : len;
+        const size_t end = beg + chunk < len ? beg + chunk : len;
+        size_t j = end;
+
+        if (end < len)
+          while (j > beg && input[j-1] == input[end])
+            --j;
+        run[c] = j;
+        if (beg >= end)
+          continue;
+        memset (type + beg / type_bits, 0,
+                type_words (end - beg) * sizeof *type);
+        /* input[len-1] is S type, unless the sentinel is virtual.  */
+        for (; j > beg; --j)
+          if (j < len ? input[j-1] > input[j]
+                        || (input[j-1] == input[j] && ltype (type, j))
+                      : virt)
+            set_ltype (type, j - 1);
+        if (counts)
+          for (j = beg; j < end; ++j)
+            ++counts[c * abclen + input[j]];
+      }
+
+    for (c = n - 1; c >= 0; --c)
+      {
+        const size_t end = (c + 1) * chunk < len ? (c + 1) * chunk : len;
+        size_t j;
+
+        if (end < len && ltype (type, end))
+          for (j = run[c]; j < end; ++j)
+            set_ltype (type, j);
+      }
+
+#pragma omp parallel for num_threads(n) schedule(static) reduction(+:lmslen)
+    for (k = 1; k < slen; ++k)
+      lmslen += is_lms (type, k);
+
+    if (counts)
+      {
+        for (c = 0; c < n; ++c)
+          for (k = 0; k < (saidx_t) abclen; ++k)
+            buckets[k] += counts[c * abclen + k];
+      }
+    else
+      for (k = 0; k < slen; ++k)
+        ++buckets[input[k]];
+    ws_free (&ctx->ws, run);
+    return lmslen;
+}
+
+/* Store the type of each position of input in type and the number of times
+   each character occurs in input in buckets, which is zero initialized.
+   When virt is not 0, the sentinel of input is virtual, which makes
+   input[len-1] L type.  The virtual sentinel is not counted as an lms
+   position.
+   Return the number of lms positions.  */
+static size_t
+classify (struct libsa_ctx *ctx, uint64_t *type, saidx_t *buckets,
+          const sym_t *input, size_t len, size_t abclen, int virt)
+{
+    size_t k;
+    size_t lmslen = 0;
+
+    if (ctx->nthreads > 1 && len > induce_block)
+      return classify_par (ctx, type, buckets, input, len, abclen, virt);
+
+    memset (type, 0, type_words (len) * sizeof *type);
+    if (virt)
+      set_ltype (type, len - 1);
+    /* We'll use 0 for S and 1 for L types.  */
+    for (k = len - 1; k > 0; --k)
+      {
+        ++buckets[input[k]];
+        if (input[k-1] > input[k])
+          {
+            set_ltype (type, k - 1);
+            if (!ltype (type, k))
+              /* input[0] can be an S type character.
+                 input[0] cannot be an lms character, by definition of lms. */
+              ++lmslen;
+          }
+        else if (input[k-1] == input[k] && ltype (type, k))
+          /* This assignment requires a right to left walk.  */
+          set_ltype (type, k - 1);
+      }
+    ++buckets[input[0]];
+    return lmslen;
+}
+
+/* Allocate buckets, b and type from the workspace of ctx, store the type of
+   each position of input in type and the end of the bucket of each
+   character in buckets.
+   b is scratch space of abclen + 1 elements.
+   The caller releases all three arrays with ws_free of buckets.
+   Return the number of lms positions.  */
+static size_t
+init_level (struct libsa_ctx *ctx, saidx_t **buckets, saidx_t **b,
+            uint64_t **type, const sym_t *input, size_t len, size_t abclen,
+            int virt)
+{
+    size_t k, lmslen;
+    double t;
+
+    *buckets = ws_alloc (&ctx->ws, abclen * sizeof **buckets);
+    memset (*buckets, 0, abclen * sizeof **buckets);
+    *b = ws_alloc (&ctx->ws, (abclen + 1) * sizeof **b);
+    *type = ws_alloc (&ctx->ws, type_words (len) * sizeof **type);
+    t = now (ctx);
+    lmslen = classify (ctx, *type, *buckets, input, len, abclen, virt);
+    ctx->stats.classify_time += now (ctx) - t;
+    /* buckets has one element for each character in the alphabet.
+       buckets[x] is the number of characters in the input string that are <= x.
+       buckets[x-1] is the beginning of the bucket for character x.
+       buckets[x]-1 is the end of the bucket for character x.
+       buckets[x] is one past the end of the bucket for character x.
+       buckets[x] is the beginning of the bucket for character x+1.  */
+    for (k = 1; k < abclen; ++k)
+      (*buckets)[k] += (*buckets)[k-1];
+    return lmslen;
+}
+
+/* The first half of a level of the sais algorithm.
+   See "Linear Suffix Array Construction by Almost Pure Induced-Sorting"
+   by Ge Nong at al for the description of this algorithm.
+   Sort the lms blocks of input and give each of them a name.  On return the
+   front of result holds the sorted lms positions and the back of result
+   holds the names of the lms blocks in the order of input, which is the
+   reduced input of the next level.
+   Store the number of lms positions in lmslen.
+   When virt is not 0, the sentinel of input is virtual.  The virtual
+   sentinel is not counted in lmslen and the sentinel of the reduced input
+   is virtual as well.
+   The statistics of the level go to the level of ctx->stats.depth, which
+   the driver of the levels counts.  depth is the indent of the log.
+   sort_lms releases all of its scratch space before it returns.
+   Return the size of the reduced alphabet.  */
+static size_t
+sort_lms (struct libsa_ctx *ctx, saidx_t *result, const sym_t *input,
+          size_t len, size_t abclen, int virt, size_t *lmslen, int depth)
+{
+    size_t redabclen;
+    uint64_t *type;
+    saidx_t *buckets, *b;
+    struct libsa_level_stats *level = 0;
+    double t;
+
+    if (ctx->stats.depth < LIBSA_MAX_DEPTH)
+      {
+        level = &ctx->stats.levels[ctx->stats.depth];
+        level->len = len;
+        level->abclen = abclen;
+      }
+
+    print (ctx, "%*sdepth = %d, len = %zu, abclen = %zu\n", depth, "", depth, len, abclen);
+    print (ctx, "%*sinput ", depth, "");
+    print_input (ctx, input, len, depth == 0, 0);
+
+    *lmslen = init_level (ctx, &buckets, &b, &type, input, len, abclen, virt);
+    print (ctx, "%*slmslen = %zu\n", depth, "", *lmslen);
+
+    /* Write indices of all lms characters to their respective buckets.  */
+    t = now (ctx);
+    insert_lms (ctx, result, input, type, buckets, b, len, abclen, depth);
+    ctx->stats.insert_lms_time += now (ctx) - t;
+    assert_full (ctx, unique (result, len));
+    t = now (ctx);
+    induce_l (ctx, result, input, type, buckets, b, len, abclen, virt, depth);
+    ctx->stats.induce_l_time += now (ctx) - t;
+    t = now (ctx);
+    induce_s (ctx, result, input, type, buckets, b, len, abclen, 0, depth);
+    ctx->stats.induce_s_time += now (ctx) - t;
+    /* At this point lms blocks are sorted in result.
+       However, equal lms blocks may still need to be swapped.  */
+
+    t = now (ctx);
+    redabclen = reduce (ctx, result, input, type, len, *lmslen, virt, depth);
+    ctx->stats.reduce_time += now (ctx) - t;
+    if (level)
+      {
+        level->lmslen = *lmslen;
+        level->redabclen = redabclen;
+      }
+    if (redabclen == *lmslen + virt)
+      print (ctx, "%*seach lms block is unique, inducing L and S positions\n",
+             depth, "");
+    else
+      print (ctx, "%*sfound equal lms blocks, building sa of lms names\n",
+             depth, "");
+    ws_free (&ctx->ws, buckets);
+    return redabclen;
+}
+
+/* The second half of a level of the sais algorithm.
+   When recursed is 0, the front of result holds the lmslen sorted lms
+   positions, as left by sort_lms.  Otherwise, the front of result holds the
+   suffix array of the reduced input, which is used to sort the lms
+   positions.
+   Induce the suffix array of input from the sorted lms positions.
+   When lcp is not null, also store the lcp array in lcp.
+   When virt is not 0, the sentinel of input is virtual and lcp is null.
+   The type and the buckets of input are computed again, rather than kept
+   from sort_lms, which keeps the scratch space of only one level at a
+   time.  */
+static void
+induce_sorted (struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+               const sym_t *input, size_t len, size_t abclen, size_t lmslen,
+               int recursed, int virt, int depth)
+{
+    uint64_t *type;
+    saidx_t *buckets, *b, *lmslcp = 0;
+    size_t k;
+    double t;
+
+    assert (!virt || !lcp);
+    init_level (ctx, &buckets, &b, &type, input, len, abclen, virt);
+    if (recursed)
+      {
+        saidx_t *lms;
+
+        print (ctx, "%*ssa of lms names ", depth, "");
+        print_array (ctx, result, lmslen, 0, 0);
+
+        /* Use the sa of lms names to sort lms blocks in result.  */
+        print (ctx, "%*susing sa of lms names to sort lms positions\n", depth, "");
+        /* lms names are no longer needed.  Reuse the back of result to keep the
+           lms positions in the order of input.  */
+        lms = result + len - lmslen;
+        for (k = 1, lmslen = 0; k < len; ++k)
+          if (is_lms (type, k))
+            lms[lmslen++] = k;
+        for (k = 0; k < lmslen; ++k)
+          result[k] = lms[result[k]];
+      }
+    print (ctx, "%*ssorted lms positions ", depth, "");
+    print_array (ctx, result, lmslen, 0, 0);
+    assert_full (ctx, all_unique (result, lmslen, len));
+    assert_full (ctx, all_sorted (result, lmslen, input, len, depth));
+
+    if (lcp)
+      {
+        t = now (ctx);
+        lmslcp = lms_lcp (ctx, lcp, result, input, type, len, lmslen, depth);
+        ctx->stats.lcp_time += now (ctx) - t;
+      }
+    t = now (ctx);
+    insert_sorted_lms (ctx, result, input, buckets, b, len, lmslen, abclen, depth);
+    ctx->stats.insert_lms_time += now (ctx) - t;
+    assert_full (ctx, unique (result, len));
+    assert_full (ctx, sorted (result, input, len, depth));
+
+    /* At this point all (even equal) lms blocks in result are sorted.
+       Induce L and S positions from sorted lms blocks.  */
+    if (lcp)
+      {
+        t = now (ctx);
+        induce_lcp (ctx, result, lcp, lmslcp, input, type, buckets, b, len,
+                    abclen, depth);
+        ctx->stats.lcp_time += now (ctx) - t;
+      }
+    else
+      {
+        t = now (ctx);
+        induce_l (ctx, result, input, type, buckets, b, len, abclen, virt,
+                  depth);
+        ctx->stats.induce_l_time += now (ctx) - t;
+        t = now (ctx);
+#ifdef SAIS_INPUT
+        /* Only the final pass of the top level emits the bwt.  */
+        induce_s (ctx, result, input, type, buckets, b, len, abclen, ctx->bwt,
+                  depth);
+#else
+        induce_s (ctx, result, input, type, buckets, b, len, abclen, 0, depth);
+#endif
+        ctx->stats.induce_s_time += now (ctx) - t;
+      }
+    print_sa (ctx, result, input, type, buckets, len, depth);
+    assert_full (ctx, all_unique (result, len, len));
+    assert_full (ctx, all_sorted (result, len, input, len, depth));
+    print (ctx, "\n");
+
+    ws_free (&ctx->ws, buckets);
+}
+
+#ifdef SAIS_INPUT
+/* The top level function of the sais algorithm.
+   build takes all of its scratch space from the workspace of ctx.  The
+   reduced input is kept in the back of result and its suffix array is built
+   by build_red in the front of result.
+   When lcp is not null, build also stores the lcp array in lcp.
+   The sentinel of input, as well as the sentinel of every reduced input, is
+   virtual when ctx says so.  */
+static int
+build (struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+       const sym_t *input, size_t len, size_t abclen, int depth)
+{
+    const int virt = ctx->virtual_sentinel;
+    size_t lmslen, redabclen;
+
+    redabclen = sort_lms (ctx, result, input, len, abclen, virt, &lmslen,
+                          depth);
+    if (redabclen != lmslen + virt)
+      build_red (ctx, result, 0, result + len - lmslen, lmslen, redabclen,
+                 depth + 3);
+    induce_sorted (ctx, result, lcp, input, len, abclen, lmslen,
+                   redabclen != lmslen + virt, virt, depth);
+    return 0;
+}
+#else
+/* The build of the reduced input.
+   Rather than recurse into itself for the reduced input of each level,
+   build walks down the levels with sort_lms, until the lms blocks of a
+   level are unique, and then walks back up the levels with induce_sorted.
+   The reduced input of a level is kept in the back of the result of the
+   previous level, which the deeper levels do not touch.  A level is
+   therefore resumed from its input, length, alphabet size and number of lms
+   positions, and neither the stack nor the workspace grows with the depth
+   of recursion.  */
+static int
+build (struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+       const sym_t *input, size_t len, size_t abclen, int depth)
+{
+    /* Each level is at most half as long as the previous one, which bounds
+       the number of levels by the number of bits of size_t.  */
+    struct
+    {
+        const sym_t *input;
+        size_t len;
+        size_t abclen;
+        size_t lmslen;
+        int recursed;
+    } levels[sizeof (size_t) * CHAR_BIT];
+    const int virt = ctx->virtual_sentinel;
+    int n;
+
+    for (n = 0;; ++n)
+      {
+        size_t redabclen;
+
+        assert (n < (int) (sizeof levels / sizeof *levels));
+        /* The statistics of this level follow those of the level above.  */
+        ++ctx->stats.depth;
+        levels[n].input = input;
+        levels[n].len = len;
+        levels[n].abclen = abclen;
+        redabclen = sort_lms (ctx, result, input, len, abclen, virt,
+                              &levels[n].lmslen, depth + 3 * n);
+        levels[n].recursed = redabclen != levels[n].lmslen + virt;
+        if (!levels[n].recursed)
+          break;
+        input = result + len - levels[n].lmslen;
+        len = levels[n].lmslen;
+        abclen = redabclen;
+      }
+    for (; n >= 0; --n)
+      induce_sorted (ctx, result, n == 0 ? lcp : 0, levels[n].input,
+                     levels[n].len, levels[n].abclen, levels[n].lmslen,
+                     levels[n].recursed, virt, depth + 3 * n);
+    return 0;
+}
+#endif
+
+#ifdef SAIS_INPUT
+#ifndef NDEBUG
+/* Return 1 if the last element of the input is the smallest.
+   Return 0 otherwise.
+   Suffix array requires that the last element is the smallest. This ensures
+   that no suffix is a prefix of another suffix. Which in turn ensures that
+   every suffix has its index in the suffix array.  */
+static int
+last_smallest (const sym_t *input, size_t len)
+{
+    size_t k;
+
+    for (k = 0; k < len - 2; ++k)
+      {
+        assert (input[len-1] < input[k]);
+        if (input[len-1] >= input[k])
+          return 0;
+      }
+    return 1;
+}
+#endif
+
+/* Return the size of the alphabet of input, which is the largest symbol of
+   input plus 1.  */
+static size_t
+alphabet_size (const sym_t *input, size_t len)
+{
+    size_t k;
+    sym_t max = 0;
+
+    for (k = 0; k < len; ++k)
+      if (input[k] > max)
+        max = input[k];
+    return (size_t) max + 1;
+}
+
+/* Check in linear time that sa is the suffix array of input.
+   sa is sorted if for every pair of adjacent suffixes either the first
+   character of the first suffix is smaller, or the first characters are equal
+   and the suffix that follows the first suffix precedes in sa the suffix that
+   follows the second one.  The empty suffix precedes every other suffix.
+   rank is scratch space of len elements, which receives the inverse of sa.
+   Return 1 on success. Return 0 on failure.  */
+static int
+verify (saidx_t *rank, const saidx_t *sa, const sym_t *input, size_t len)
+{
+    size_t k;
+
+    memset (rank, -1, len * sizeof *rank);
+    for (k = 0; k < len; ++k)
+      {
+        const saidx_t pos = sa[k];
+        if (pos < 0 || (size_t) pos >= len || rank[pos] >= 0)
+          return 0;
+        rank[pos] = k;
+      }
+    for (k = 1; k < len; ++k)
+      {
+        const saidx_t x = sa[k-1], y = sa[k];
+        saidx_t rx, ry;
+        if (input[x] < input[y])
+          continue;
+        if (input[x] > input[y])
+          return 0;
+        rx = (size_t) x + 1 < len ? rank[x+1] : -1;
+        ry = (size_t) y + 1 < len ? rank[y+1] : -1;
+        if (rx >= ry)
+          return 0;
+      }
+    return 1;
+}
+
+/* The top level function of the phi algorithm.
+   See "Permuted Longest-Common-Prefix Array"
+   by Juha Karkkainen at al for the description of this algorithm.
+   Store in result the lcp array of sa, which is the suffix array of input.
+   The comparison of two suffixes stops at the end of input, which makes
+   phi_lcp work whether the sentinel of input is real or virtual.
+   In the low memory mode result holds phi, then plcp and then lcp.
+   Otherwise phi and plcp are taken from the workspace of ctx.  */
+static void
+phi_lcp (struct libsa_ctx *ctx, saidx_t *result, const saidx_t *sa,
+         const sym_t *input, size_t len)
+{
+    saidx_t *phi, *plcp;
+    saidx_t k;
+    const saidx_t slen = len;
+    /* The number of threads and the number of chunks of plcp.  */
+    int n, c;
+    size_t chunk;
+    const double t = now (ctx);
+
+    n = len > induce_block ? ctx->nthreads : 1;
+    if (ctx->lowmem)
+      phi = plcp = result;
+    else
+      {
+        phi = ws_alloc (&ctx->ws, len * sizeof *phi);
+        plcp = ws_alloc (&ctx->ws, len * sizeof *plcp);
+        if (ctx->ws.peak > ctx->stats.peak_scratch)
+          ctx->stats.peak_scratch = ctx->ws.peak;
+      }
+
+    /* Build phi.  The first suffix of sa has no predecessor.  */
+    phi[sa[0]] = -1;
+#pragma omp parallel for num_threads(n) schedule(static)
+    for (k = 1; k < slen; ++k)
+      phi[sa[k]] = sa[k-1];
+
+    /* Build plcp from phi.
+       Each thread builds plcp of one chunk of input.  The first element of a
+       chunk is computed from scratch, rather than from the prior element,
+       which makes the chunks independent.
+       plcp[j] depends only on phi[j], which allows plcp and phi to be the
+       same array.  */
+    chunk = (len + n - 1) / n;
+#pragma omp parallel for num_threads(n) schedule(static)
+    for (c = 0; c < n; ++c)
+      {
+        const size_t beg = c * chunk;
+        const size_t end = beg + chunk < len ? beg + chunk : len;
+        size_t j;
+        saidx_t l;
+
+        for (j = beg, l = 0; j < end; ++j)
+          {
+            const saidx_t x = phi[j];
+            size_t m;
+
+            if (x < 0)
+              {
+                plcp[j] = l = 0;
+                continue;
+              }
+            /* The suffix that ends first bounds the common prefix.  */
+            m = len - (j > (size_t) x ? j : (size_t) x);
+            while ((size_t) l < m && input[j+l] == input[x+l])
+              ++l;
+            assert (l >= 0);
+            plcp[j] = l;
+            l = l ? l - 1 : 0;
+          }
+      }
+
+    /* Build lcp from plcp.  */
+    if (ctx->lowmem)
+      permute_plcp (result, sa, len);
+    else
+      {
+#pragma omp parallel for num_threads(n) schedule(static)
+        for (k = 1; k < slen; ++k)
+          result[k] = plcp[sa[k]];
+        ws_free (&ctx->ws, phi);
+      }
+
+    ctx->stats.lcp_time = now (ctx) - t;
+    print (ctx, "lcp    ");
+    print_array (ctx, result + 1, len - 1, 0, 0);
+}
+
+/* Build the suffix array of input in result.
+   When lcp is not null, also build the lcp array in lcp.
+   When the sentinel of input is virtual, lcp is built by phi_lcp after the
+   suffix array, rather than induced along with the suffix array.
+   build reads input directly, rather than a copy.
+   Take the scratch space from the workspace of ctx.
+   Return 0 on success.
+   Return -1 if the workspace is too small or if the checks of ctx find that
+   result is not sorted.  */
+static int
+build_top (struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+           const sym_t *input, size_t len, size_t abclen)
+{
+    memset (&ctx->stats, 0, sizeof ctx->stats);
+    ctx->ws.peak = ctx->ws.used;
+    if (len > 0)
+      *result = 0;
+    if (lcp && len > 0)
+      *lcp = 0;
+    if (len < 2)
+      return 0;
+
+    assert (ctx->virtual_sentinel || last_smallest (input, len));
+    assert (alphabet_size (input, len) <= abclen);
+
+    if (ctx->ws.size - ctx->ws.used < SA_(libsa_workspace_size) (len, abclen)
+                                      + (lcp ? lcp_ws_size (len, abclen) : 0))
+      return -1;
+    build (ctx, result, ctx->virtual_sentinel ? 0 : lcp, input, len, abclen,
+           0);
+    print (ctx, "recursion depth = %d\n", ctx->stats.depth);
+    ctx->stats.peak_scratch = ctx->ws.peak;
+    if (lcp && ctx->virtual_sentinel)
+      phi_lcp (ctx, lcp, result, input, len);
+    if (ctx->check >= LIBSA_CHECK_CHEAP)
+      {
+        saidx_t *rank = ws_alloc (&ctx->ws, len * sizeof *rank);
+        int ok = verify (rank, result, input, len);
+        assert (ok);
+        ws_free (&ctx->ws, rank);
+        return ok ? 0 : -1;
+      }
+    return 0;
+}
+
+/* Return the size of the workspace that compact_input needs for an input of
+   len symbols less than abclen.  */
+static size_t
+compact_ws_size (size_t len, size_t abclen)
+{
+    const size_t nwords = (abclen + 63) / 64;
+
+    return ws_round (len * sizeof (sym_t))
+           + ws_round (nwords * sizeof (uint64_t))
+           + ws_round (nwords * sizeof (saidx_t));
+}
+
+/* Map the symbols of input that occur in input to 0, 1, 2 and so on, in the
+   order of the symbols, and store the mapped input in dense.
+   The order of the symbols is kept, which makes the suffix array of dense the
+   same as that of input.
+   The used symbols are marked in a bitset.  The mapped value of a symbol is
+   the number of used symbols smaller than the symbol, which is the count of
+   the preceding words of the bitset plus the bits of the word of the
+   symbol below the symbol.
+   Return the size of the alphabet of dense.
+   Return 0 and leave dense untouched when more than half of the alphabet is
+   used, in which case compaction does not pay off.  */
+static size_t
+compact_input (struct libsa_ctx *ctx, sym_t *dense, const sym_t *input,
+               size_t len, size_t abclen)
+{
+    const size_t nwords = (abclen + 63) / 64;
+    uint64_t *used;
+    saidx_t *count;
+    size_t k, n;
+
+    used = ws_alloc (&ctx->ws, nwords * sizeof *used);
+    count = ws_alloc (&ctx->ws, nwords * sizeof *count);
+    memset (used, 0, nwords * sizeof *used);
+    for (k = 0; k < len; ++k)
+      used[input[k] / 64] |= (uint64_t) 1 << input[k] % 64;
+    for (k = 0, n = 0; k < nwords; ++k)
+      {
+        count[k] = n;
+        n += __builtin_popcountll (used[k]);
+      }
+    if (2 * n > abclen)
+      n = 0;
+    else
+      for (k = 0; k < len; ++k)
+        {
+          const sym_t c = input[k];
+          const uint64_t below = ((uint64_t) 1 << c % 64) - 1;
+          dense[k] = count[c / 64]
+                     + __builtin_popcountll (used[c / 64] & below);
+        }
+    ws_free (&ctx->ws, used);
+    print (ctx, "compacted abclen = %zu to %zu\n", abclen, n ? n : abclen);
+    return n;
+}
+
+/* The same as build_top, except that ctx_build grows the workspace of ctx
+   to the size that the build needs.
+   When abclen is 0, the alphabet size is computed from input.
+   When compaction is enabled and abclen is large, the build is made on input
+   compacted to the used symbols, if that reduces the alphabet by at least
+   half.
+   Return -1 if abclen does not fit saidx_t.  */
+static int
+ctx_build (struct libsa_ctx *ctx, saidx_t *result, saidx_t *lcp,
+           const sym_t *input, size_t len, size_t abclen)
+{
+    sym_t *dense;
+    size_t denseabclen;
+    int rc;
+
+    if (abclen == 0)
+      abclen = alphabet_size (input, len);
+    if (abclen - 1 > (size_t) saidx_max)
+      return -1;
+    if (!ctx->compact || abclen <= compact_abclen || len < 2)
+      {
+        if (ctx_reserve (ctx, SA_(libsa_workspace_size) (len, abclen)
+                              + (lcp ? lcp_ws_size (len, abclen) : 0)
+                              + par_ws_size (ctx)) < 0)
+          return -1;
+        return build_top (ctx, result, lcp, input, len, abclen);
+      }
+
+    /* Either input is compacted to at most len symbols, or compact_input finds
+       that more than half of abclen symbols are used, which makes abclen less
+       than 2 * len.  */
+    denseabclen = abclen < 2 * len ? abclen : 2 * len;
+    if (ctx_reserve (ctx, compact_ws_size (len, abclen)
+                          + SA_(libsa_workspace_size) (len, denseabclen)
+                          + (lcp ? lcp_ws_size (len, denseabclen) : 0)
+                          + par_ws_size (ctx)) < 0)
+      return -1;
+    dense = ws_alloc (&ctx->ws, len * sizeof *dense);
+    denseabclen = compact_input (ctx, dense, input, len, abclen);
+    if (denseabclen)
+      rc = build_top (ctx, result, lcp, dense, len, denseabclen);
+    else
+      rc = build_top (ctx, result, lcp, input, len, abclen);
+    ws_free (&ctx->ws, dense);
+    return rc;
+}
+#endif
+
+#undef print_input
+#undef print_sa
+#undef sufcmp
+#undef sorted
+#undef all_sorted
+#undef lms_blocks_differ
+#undef reduce
+#undef insert_lms
+#undef insert_sorted_lms
+#undef prefetch
+#undef induce_l_par
+#undef induce_s_par
+#undef induce_l
+#undef induce_s
+#undef naive_lcp
+#undef lms_lcp
+#undef induce_l_lcp
+#undef induce_s_lcp
+#undef induce_lcp
+#undef classify_par
+#undef classify
+#undef init_level
+#undef sort_lms
+#undef induce_sorted
+#undef build
+#undef last_smallest
+#undef alphabet_size
+#undef verify
+#undef phi_lcp
+#undef build_top
+#undef compact_ws_size
+#undef compact_input
+#undef ctx_build
+
+/* Copyright (c) 2025 Dmitry Goncharov
+ * dgoncharov@users.sf.net.
+ *
+ * Distributed under GPL v2 or the BSD License (see accompanying file copying),
+ * your choice.
+ */
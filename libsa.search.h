@@ -0,0 +1,326 @@
+/* The search of patterns in a suffix array.
+   libsa.c includes this file once for each index type, after libsa.core.h,
+   with the same definitions of saidx_t, saidx_max and SA_.  */
+
+#define lcplr_rec SA_(lcplr_rec)
+#define match SA_(match)
+#define bound SA_(bound)
+#define narrow SA_(narrow)
+#define locate_sorted SA_(locate_sorted)
+
+/* Store to llcp[m] the lcp of the suffixes at l and m of sa and to rlcp[m]
+   the lcp of the suffixes at m and r, for m the midpoint of l and r, and
+   recursively for the midpoints of l and m and of m and r.
+   l == -1 and r == len stand for a suffix smaller and a suffix larger than
+   any suffix, whose lcp with any suffix is 0.
+   Return the lcp of the suffixes at l and r, which is the smallest element
+   of lcp between l + 1 and r.  */
+static saidx_t
+lcplr_rec (saidx_t *llcp, saidx_t *rlcp, const saidx_t *lcp, saidx_t len,
+           saidx_t l, saidx_t r)
+{
+    saidx_t m, x, y;
+
+    if (r - l == 1)
+      return l < 0 || r == len ? 0 : lcp[r];
+    m = l + (r - l) / 2;
+    x = lcplr_rec (llcp, rlcp, lcp, len, l, m);
+    y = lcplr_rec (llcp, rlcp, lcp, len, m, r);
+    llcp[m] = x;
+    rlcp[m] = y;
+    return x < y ? x : y;
+}
+
+/* Compare pattern of plen characters with the suffix of input at pos.
+   The first *k characters are known to be equal and are not compared.
+   Store the length of the common prefix of pattern and the suffix, at most
+   plen, to *k.
+   Return a negative value if the suffix is smaller than pattern.
+   Return 0 if pattern is a prefix of the suffix.
+   Return a positive value otherwise.  */
+static int
+match (const unsigned char *input, size_t len, size_t pos,
+       const unsigned char *pattern, size_t plen, size_t *k)
+{
+    size_t j;
+
+    for (j = *k; j < plen && pos + j < len && input[pos+j] == pattern[j]; ++j)
+      ;
+    *k = j;
+    if (j == plen)
+      return 0;
+    if (pos + j == len)
+      /* The suffix is a proper prefix of pattern.  */
+      return -1;
+    return input[pos+j] < pattern[j] ? -1 : 1;
+}
+
+/* Return the number of suffixes of sa that are smaller than pattern and do
+   not start with pattern.  When upper is 1, also count the suffixes that
+   start with pattern.
+   The search keeps the lcps of pattern with the suffixes at the bounds l and
+   r of the interval.  Every suffix between the bounds has at least the
+   smaller of these lcps in common with pattern, which is skipped by the
+   comparison.
+   When llcp and rlcp are not null, they hold the lcps of the bounds with
+   the midpoint, as stored by lcplr_rec.  The lcp of the midpoint with the
+   bound that has the larger lcp with pattern then decides the step without
+   a comparison, unless the two are equal, in which case the comparison
+   skips the larger lcp.  The comparisons then never go back to a character
+   of pattern that already matched, which takes O (plen + log len) character
+   comparisons.  */
+static size_t
+bound (const saidx_t *sa, const saidx_t *llcp, const saidx_t *rlcp,
+       const unsigned char *input, size_t len, const unsigned char *pattern,
+       size_t plen, int upper)
+{
+    saidx_t l = -1, r = len, m;
+    size_t lk = 0, rk = 0, k;
+    int c;
+
+    while (r - l > 1)
+      {
+        m = l + (r - l) / 2;
+        if (llcp && lk >= rk)
+          {
+            k = lk;
+            if ((size_t) llcp[m] > lk)
+              {
+                l = m;
+                continue;
+              }
+            if ((size_t) llcp[m] < lk)
+              {
+                r = m;
+                rk = llcp[m];
+                continue;
+              }
+          }
+        else if (llcp)
+          {
+            k = rk;
+            if ((size_t) rlcp[m] > rk)
+              {
+                r = m;
+                continue;
+              }
+            if ((size_t) rlcp[m] < rk)
+              {
+                l = m;
+                lk = rlcp[m];
+                continue;
+              }
+          }
+        else
+          k = lk < rk ? lk : rk;
+        c = match (input, len, sa[m], pattern, plen, &k);
+        if (c < 0 || (c == 0 && upper))
+          {
+            l = m;
+            lk = k;
+          }
+        else
+          {
+            r = m;
+            rk = k;
+          }
+      }
+    return r;
+}
+
+/* Narrow the interval from *lo to *hi of sa, whose suffixes have their
+   first d characters in common, to the suffixes whose character d is c.
+   The suffix of d characters, if any, precedes the others in the interval.
+   The interval becomes empty at the position of c in the order, when no
+   suffix of the interval has c at d.  */
+static void
+narrow (const saidx_t *sa, const unsigned char *input, size_t len, size_t d,
+        int c, size_t *lo, size_t *hi)
+{
+    size_t l = *lo, r = *hi, m;
+
+    while (l < r)
+      {
+        m = l + (r - l) / 2;
+        if (sa[m] + d == len || input[sa[m]+d] < c)
+          l = m + 1;
+        else
+          r = m;
+      }
+    *lo = l;
+    r = *hi;
+    while (l < r)
+      {
+        m = l + (r - l) / 2;
+        if (input[sa[m]+d] <= c)
+          l = m + 1;
+        else
+          r = m;
+      }
+    *hi = l;
+}
+
+/* Find the suffixes of input that start with the pattern of each of the nq
+   queries of q, which are sorted by query_cmp.
+   lo[d] and hi[d] are the interval of the suffixes that start with the
+   first d characters of the pattern of the current query.  Each interval
+   is narrowed from the previous one by one character.  The sorted order
+   makes neighbouring queries share a prefix, whose intervals are kept from
+   the previous query, rather than searched again.  The narrowing stops
+   when one suffix is left, which is then compared with the rest of the
+   pattern.
+   lo and hi have one element more than the longest pattern.  */
+static void
+locate_sorted (size_t *first, size_t *count, const saidx_t *sa,
+               const unsigned char *input, size_t len, const struct query *q,
+               size_t nq, size_t *lo, size_t *hi)
+{
+    size_t k, d, top = 0;
+
+    lo[0] = 0;
+    hi[0] = len;
+    for (k = 0; k < nq; ++k)
+      {
+        const unsigned char *p = q[k].pattern;
+        const size_t plen = q[k].plen;
+        size_t f, n;
+
+        /* lo and hi up to top are the intervals of the previous pattern.  */
+        d = 0;
+        if (k > 0)
+          for (; d < top && d < plen && q[k-1].pattern[d] == p[d]; ++d)
+            ;
+        for (; d < plen && hi[d] - lo[d] > 1; ++d)
+          {
+            lo[d+1] = lo[d];
+            hi[d+1] = hi[d];
+            narrow (sa, input, len, d, p[d], &lo[d+1], &hi[d+1]);
+          }
+        top = d;
+        f = lo[d];
+        n = hi[d] - lo[d];
+        if (d < plen && n == 1)
+          {
+            size_t j = d;
+            const int c = match (input, len, sa[f], p, plen, &j);
+
+            if (c != 0)
+              {
+                n = 0;
+                f += c < 0;
+              }
+          }
+        if (first)
+          first[q[k].idx] = f;
+        count[q[k].idx] = n;
+      }
+}
+
+int
+SA_(libsa_build_lcplr) (saidx_t *llcp, saidx_t *rlcp, const saidx_t *lcp,
+                        size_t len)
+{
+    if (len > 0)
+      lcplr_rec (llcp, rlcp, lcp, len, -1, len);
+    return 0;
+}
+
+size_t
+SA_(libsa_locate) (size_t *first, const saidx_t *sa, const saidx_t *llcp,
+                   const saidx_t *rlcp, const char *input, size_t len,
+                   const char *pattern, size_t plen)
+{
+    const unsigned char *in = (const unsigned char *) input;
+    const unsigned char *p = (const unsigned char *) pattern;
+    size_t lo, hi;
+
+    lo = bound (sa, llcp, rlcp, in, len, p, plen, 0);
+    hi = bound (sa, llcp, rlcp, in, len, p, plen, 1);
+    if (first)
+      *first = lo;
+    return hi - lo;
+}
+
+size_t
+SA_(libsa_count) (const saidx_t *sa, const saidx_t *llcp, const saidx_t *rlcp,
+                  const char *input, size_t len, const char *pattern,
+                  size_t plen)
+{
+    return SA_(libsa_locate) (0, sa, llcp, rlcp, input, len, pattern, plen);
+}
+
+int
+SA_(libsa_ctx_locate_batch) (struct libsa_ctx *ctx, size_t *first,
+                             size_t *count, const saidx_t *sa,
+                             const char *input, size_t len,
+                             const char *const *patterns, const size_t *plens,
+                             size_t npatterns)
+{
+    struct query *q;
+    size_t *stack, k, maxplen = 0, stride;
+    int t, nchunks;
+
+    if (npatterns == 0)
+      return 0;
+    for (k = 0; k < npatterns; ++k)
+      if (plens[k] > maxplen)
+        maxplen = plens[k];
+    nchunks = npatterns < (size_t) ctx->nthreads ? (int) npatterns
+                                                 : ctx->nthreads;
+    stride = 2 * (maxplen + 1);
+    if (ctx_reserve (ctx, ws_round (npatterns * sizeof *q)
+                          + ws_round (nchunks * stride * sizeof *stack)) < 0)
+      return -1;
+    q = ws_alloc (&ctx->ws, npatterns * sizeof *q);
+    stack = ws_alloc (&ctx->ws, nchunks * stride * sizeof *stack);
+    for (k = 0; k < npatterns; ++k)
+      {
+        q[k].pattern = (const unsigned char *) patterns[k];
+        q[k].plen = plens[k];
+        q[k].idx = k;
+      }
+    qsort (q, npatterns, sizeof *q, query_cmp);
+
+    /* Each thread searches a run of adjacent queries.  */
+#pragma omp parallel for num_threads(nchunks) schedule(static)
+    for (t = 0; t < nchunks; ++t)
+      {
+        const size_t beg = npatterns * t / nchunks;
+        const size_t end = npatterns * (t + 1) / nchunks;
+        size_t *lo = stack + t * stride;
+
+        locate_sorted (first, count, sa, (const unsigned char *) input, len,
+                       q + beg, end - beg, lo, lo + maxplen + 1);
+      }
+    ws_free (&ctx->ws, q);
+    return 0;
+}
+
+int
+SA_(libsa_locate_batch) (size_t *first, size_t *count, const saidx_t *sa,
+                         const char *input, size_t len,
+                         const char *const *patterns, const size_t *plens,
+                         size_t npatterns)
+{
+    int rc;
+    struct libsa_ctx ctx;
+
+    ctx_init (&ctx);
+    rc = SA_(libsa_ctx_locate_batch) (&ctx, first, count, sa, input, len,
+                                      patterns, plens, npatterns);
+    ctx_release (&ctx);
+    return rc;
+}
+
+#undef lcplr_rec
+#undef match
+#undef bound
+#undef narrow
+#undef locate_sorted
+
+/* Copyright (c) 2025 Dmitry Goncharov
+ * dgoncharov@users.sf.net.
+ *
+ * Distributed under GPL v2 or the BSD License (see accompanying file copying),
+ * your choice.
+ */
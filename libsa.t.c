@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <limits.h>
+#include <stdint.h>
 
 static int verbose;
 
@@ -120,6 +121,514 @@ testlcp_imp (const char *input, int lineno)
     free (sa);
 }
 
+/* Check that libsa_build64 and libsa_build_lcp64 produce the same arrays as
+   libsa_build and libsa_build_lcp.  */
+static void
+test64_imp (const char *input, int lineno)
+{
+    size_t k, len = strlen (input) + 1;
+    int *sa, *lcp;
+    int64_t *sa64, *lcp64;
+
+    sa = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    sa64 = alloc (len * sizeof *sa64);
+    lcp64 = alloc (len * sizeof *lcp64);
+    memset (sa64, -1, len * sizeof *sa64);
+    memset (lcp64, -1, len * sizeof *lcp64);
+    libsa_build (sa, input, len);
+    libsa_build_lcp (lcp, sa, input, len);
+    libsa_build64 (sa64, input, len);
+    libsa_build_lcp64 (lcp64, sa64, input, len);
+    for (k = 0; k < len; ++k)
+      {
+        ASSERT (sa[k] == sa64[k], "sa[%zu] = %d, sa64[%zu] = %lld, lineno = %d\n",
+                k, sa[k], k, (long long) sa64[k], lineno);
+        ASSERT (lcp[k] == lcp64[k], "lcp[%zu] = %d, lcp64[%zu] = %lld, lineno = %d\n",
+                k, lcp[k], k, (long long) lcp64[k], lineno);
+      }
+    free (lcp64);
+    free (sa64);
+    free (lcp);
+    free (sa);
+}
+
+/* Check that a build on nthreads threads produces the same suffix array and
+   lcp array as libsa_build and libsa_build_lcp.  */
+static void
+testpar_imp (const char *input, size_t len, int nthreads, int lineno)
+{
+    size_t k;
+    int *sa, *sa2, *lcp, *lcp2;
+    struct libsa_ctx *ctx;
+
+    sa = alloc_init (-1, len);
+    sa2 = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    lcp2 = alloc_init (-1, len);
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_threads (ctx, nthreads);
+    libsa_ctx_build (ctx, sa, input, len);
+    libsa_build (sa2, input, len);
+    for (k = 0; k < len; ++k)
+      if (sa[k] != sa2[k])
+        {
+          ASSERT (sa[k] == sa2[k], "sa[%zu] = %d, sa2[%zu] = %d, lineno = %d\n",
+                  k, sa[k], k, sa2[k], lineno);
+          break;
+        }
+    libsa_ctx_build_lcp (ctx, lcp, sa, input, len);
+    libsa_build_lcp (lcp2, sa2, input, len);
+    for (k = 1; k < len; ++k)
+      if (lcp[k] != lcp2[k])
+        {
+          ASSERT (lcp[k] == lcp2[k], "lcp[%zu] = %d, lcp2[%zu] = %d, lineno = %d\n",
+                  k, lcp[k], k, lcp2[k], lineno);
+          break;
+        }
+    libsa_ctx_destroy (ctx);
+    free (lcp2);
+    free (lcp);
+    free (sa2);
+    free (sa);
+}
+
+/* Check that the lcp array built in place on nthreads threads is the same as
+   the one built by libsa_build_lcp.  */
+static void
+testlowmem_imp (const char *input, size_t len, int nthreads, int lineno)
+{
+    size_t k;
+    int *sa, *lcp, *lcp2;
+    struct libsa_ctx *ctx;
+
+    sa = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    lcp2 = alloc_init (-1, len);
+    libsa_build (sa, input, len);
+    libsa_build_lcp (lcp2, sa, input, len);
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_threads (ctx, nthreads);
+    libsa_ctx_set_lowmem (ctx, 1);
+    libsa_ctx_build_lcp (ctx, lcp, sa, input, len);
+    if (len > 1)
+      ASSERT (lcp[0] == 0, "lcp[0] = %d, lineno = %d\n", lcp[0], lineno);
+    for (k = 1; k < len; ++k)
+      if (lcp[k] != lcp2[k])
+        {
+          ASSERT (lcp[k] == lcp2[k], "lcp[%zu] = %d, lcp2[%zu] = %d, lineno = %d\n",
+                  k, lcp[k], k, lcp2[k], lineno);
+          break;
+        }
+    libsa_ctx_destroy (ctx);
+    free (lcp2);
+    free (lcp);
+    free (sa);
+}
+
+/* Check that libsa_build_sa_lcp and libsa_build_sa_lcp64 produce the same
+   arrays as libsa_build and libsa_build_lcp.  */
+static void
+testsalcp_imp (const char *input, size_t len, int lineno)
+{
+    size_t k;
+    int *sa, *sa2, *lcp, *lcp2;
+    int64_t *sa64, *lcp64;
+
+    sa = alloc_init (-1, len);
+    sa2 = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    lcp2 = alloc_init (-1, len);
+    sa64 = alloc (len * sizeof *sa64);
+    lcp64 = alloc (len * sizeof *lcp64);
+    libsa_build_sa_lcp (sa, lcp, input, len);
+    libsa_build_sa_lcp64 (sa64, lcp64, input, len);
+    libsa_build (sa2, input, len);
+    libsa_build_lcp (lcp2, sa2, input, len);
+    if (len > 0)
+      ASSERT (lcp[0] == 0, "lcp[0] = %d, lineno = %d\n", lcp[0], lineno);
+    for (k = 0; k < len; ++k)
+      if (sa[k] != sa2[k] || sa[k] != sa64[k])
+        {
+          ASSERT (sa[k] == sa2[k], "sa[%zu] = %d, sa2[%zu] = %d, lineno = %d\n",
+                  k, sa[k], k, sa2[k], lineno);
+          ASSERT (sa[k] == sa64[k], "sa[%zu] = %d, sa64[%zu] = %lld, lineno = %d\n",
+                  k, sa[k], k, (long long) sa64[k], lineno);
+          break;
+        }
+    for (k = 1; k < len; ++k)
+      if (lcp[k] != lcp2[k] || lcp[k] != lcp64[k])
+        {
+          ASSERT (lcp[k] == lcp2[k], "lcp[%zu] = %d, lcp2[%zu] = %d, lineno = %d\n",
+                  k, lcp[k], k, lcp2[k], lineno);
+          ASSERT (lcp[k] == lcp64[k], "lcp[%zu] = %d, lcp64[%zu] = %lld, lineno = %d\n",
+                  k, lcp[k], k, (long long) lcp64[k], lineno);
+          break;
+        }
+    free (lcp64);
+    free (sa64);
+    free (lcp2);
+    free (lcp);
+    free (sa2);
+    free (sa);
+}
+
+/* Check that libsa_build_sym builds the suffix array and the lcp array of
+   a random input of len symbols less than abclen, both as uint32_t symbols
+   and, when abclen allows, as uint16_t symbols.  */
+static void
+testsym_imp (size_t len, size_t abclen, int lineno)
+{
+    size_t k;
+    int rc;
+    int *sa, *lcp, *sa2, *lcp2;
+    uint32_t *input;
+    uint16_t *input16;
+
+    sa = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    sa2 = alloc_init (-1, len);
+    lcp2 = alloc_init (-1, len);
+    input = alloc (len * sizeof *input);
+    input16 = alloc (len * sizeof *input16);
+    for (k = 0; k < len - 1; ++k)
+      input[k] = 1 + rand () % (abclen - 1);
+    input[len-1] = 0;
+
+    rc = libsa_build_sym (sa, lcp, input, sizeof *input, len, abclen);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    ASSERT ((size_t) sa[0] == len - 1, "sa[0] = %d, lineno = %d\n", sa[0],
+            lineno);
+    for (k = 1; k < len; ++k)
+      {
+        const uint32_t *x = input + sa[k-1], *y = input + sa[k];
+        int l;
+
+        /* The last symbol is unique, which stops this loop.  */
+        for (l = 0; x[l] == y[l]; ++l)
+          ;
+        ASSERT (x[l] < y[l], "k = %zu, lineno = %d\n", k, lineno);
+        ASSERT (lcp[k] == l, "lcp[%zu] = %d, l = %d, lineno = %d\n",
+                k, lcp[k], l, lineno);
+      }
+
+    /* The alphabet size is computed.  */
+    rc = libsa_build_sym (sa2, lcp2, input, sizeof *input, len, 0);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    ASSERT (memcmp (sa, sa2, len * sizeof *sa) == 0, "lineno = %d\n", lineno);
+    ASSERT (memcmp (lcp, lcp2, len * sizeof *lcp) == 0, "lineno = %d\n",
+            lineno);
+
+    if (abclen <= UINT16_MAX + 1)
+      {
+        for (k = 0; k < len; ++k)
+          input16[k] = input[k];
+        memset (sa2, -1, len * sizeof *sa2);
+        rc = libsa_build_sym (sa2, 0, input16, sizeof *input16, len, abclen);
+        ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+        ASSERT (memcmp (sa, sa2, len * sizeof *sa) == 0, "lineno = %d\n",
+                lineno);
+      }
+    free (input16);
+    free (input);
+    free (lcp2);
+    free (sa2);
+    free (lcp);
+    free (sa);
+}
+
+/* Check that a build with a virtual sentinel on nthreads threads builds the
+   suffix array and the lcp array of input, whose last character does not
+   have to be the smallest.  */
+static void
+testvirt_imp (const char *input, size_t len, int nthreads, int lineno)
+{
+    size_t k;
+    int rc;
+    int *sa, *lcp, *lcp2;
+    struct libsa_ctx *ctx;
+
+    sa = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    lcp2 = alloc_init (-1, len);
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_threads (ctx, nthreads);
+    libsa_ctx_set_virtual_sentinel (ctx, 1);
+    rc = libsa_ctx_build_sa_lcp (ctx, sa, lcp, input, len);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    rc = libsa_verify (sa, input, len);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    for (k = 1; k < len; ++k)
+      {
+        const size_t x = sa[k-1], y = sa[k];
+        size_t l;
+
+        for (l = 0; x + l < len && y + l < len && input[x+l] == input[y+l];
+             ++l)
+          ;
+        ASSERT (lcp[k] == (int) l, "lcp[%zu] = %d, l = %zu, lineno = %d\n",
+                k, lcp[k], l, lineno);
+      }
+    libsa_ctx_set_lowmem (ctx, 1);
+    libsa_ctx_build_lcp (ctx, lcp2, sa, input, len);
+    if (len > 1)
+      ASSERT (memcmp (lcp + 1, lcp2 + 1, (len - 1) * sizeof *lcp) == 0,
+              "lineno = %d\n", lineno);
+    libsa_ctx_destroy (ctx);
+    free (lcp2);
+    free (lcp);
+    free (sa);
+}
+
+/* Create an empty temporary file and store its name to path.  */
+static void
+temp_file (char *path, int lineno)
+{
+    FILE *f;
+    int fd;
+
+    strcpy (path, "/tmp/libsa.t.XXXXXX");
+    fd = mkstemp (path);
+    ASSERT (fd >= 0, "errno = %d, lineno = %d\n", errno, lineno);
+    f = fdopen (fd, "w");
+    ASSERT (f, "errno = %d, lineno = %d\n", errno, lineno);
+    fclose (f);
+}
+
+/* Read len ints from the file at path to a new array.  */
+static int*
+read_ints (const char *path, size_t len, int lineno)
+{
+    int *r = alloc_init (-1, len + 1);
+    FILE *f = fopen (path, "rb");
+    size_t n;
+
+    ASSERT (f, "errno = %d, lineno = %d\n", errno, lineno);
+    n = fread (r, sizeof *r, len + 1, f);
+    ASSERT (n == len, "n = %zu, len = %zu, lineno = %d\n", n, len, lineno);
+    fclose (f);
+    return r;
+}
+
+/* Check that libsa_build_file builds the same suffix array and lcp array of
+   the len characters of input as a build with a virtual sentinel in memory
+   does.  */
+static void
+testfile_imp (const char *input, size_t len, int lineno)
+{
+    char in_path[32], sa_path[32], lcp_path[32];
+    int *sa, *lcp, *fsa, *flcp;
+    struct libsa_ctx *ctx;
+    FILE *f;
+    int rc;
+
+    temp_file (in_path, lineno);
+    temp_file (sa_path, lineno);
+    temp_file (lcp_path, lineno);
+    f = fopen (in_path, "wb");
+    ASSERT (f, "errno = %d, lineno = %d\n", errno, lineno);
+    ASSERT (fwrite (input, 1, len, f) == len, "lineno = %d\n", lineno);
+    fclose (f);
+
+    rc = libsa_build_file (in_path, sa_path, lcp_path);
+    ASSERT (rc == 0, "rc = %d, errno = %d, lineno = %d\n", rc, errno, lineno);
+    fsa = read_ints (sa_path, len, lineno);
+    flcp = read_ints (lcp_path, len, lineno);
+
+    sa = alloc_init (-1, len);
+    lcp = alloc_init (-1, len);
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_virtual_sentinel (ctx, 1);
+    rc = libsa_ctx_build_sa_lcp (ctx, sa, lcp, input, len);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    ASSERT (memcmp (sa, fsa, len * sizeof *sa) == 0, "lineno = %d\n", lineno);
+    if (len > 0)
+      {
+        ASSERT (flcp[0] == 0, "flcp[0] = %d, lineno = %d\n", flcp[0], lineno);
+        ASSERT (memcmp (lcp + 1, flcp + 1, (len - 1) * sizeof *lcp) == 0,
+                "lineno = %d\n", lineno);
+      }
+    free (fsa);
+    free (flcp);
+
+    /* Without the lcp array.  */
+    rc = libsa_ctx_build_file (ctx, in_path, sa_path, 0);
+    ASSERT (rc == 0, "rc = %d, errno = %d, lineno = %d\n", rc, errno, lineno);
+    fsa = read_ints (sa_path, len, lineno);
+    ASSERT (memcmp (sa, fsa, len * sizeof *sa) == 0, "lineno = %d\n", lineno);
+    libsa_ctx_destroy (ctx);
+
+    free (fsa);
+    free (lcp);
+    free (sa);
+    remove (lcp_path);
+    remove (sa_path);
+    remove (in_path);
+}
+
+/* Check that libsa_locate finds the suffixes of input that start with the
+   plen characters of pattern, both with and without llcp and rlcp.  */
+static void
+testlocate_imp (const int *sa, const int *llcp, const int *rlcp,
+                const char *input, size_t len, const char *pattern,
+                size_t plen, int lineno)
+{
+    size_t k, n, first, first2, count, count2;
+
+    n = 0;
+    for (k = 0; k < len && k + plen <= len; ++k)
+      n += memcmp (input + k, pattern, plen) == 0;
+    count = libsa_locate (&first, sa, llcp, rlcp, input, len, pattern, plen);
+    ASSERT (count == n, "count = %zu, n = %zu, lineno = %d\n", count, n,
+            lineno);
+    for (k = first; k < first + count; ++k)
+      ASSERT (sa[k] + plen <= len && memcmp (input + sa[k], pattern, plen) == 0,
+              "k = %zu, lineno = %d\n", k, lineno);
+    count2 = libsa_locate (&first2, sa, 0, 0, input, len, pattern, plen);
+    ASSERT (count2 == count && (count == 0 || first2 == first),
+            "count2 = %zu, first2 = %zu, lineno = %d\n", count2, first2,
+            lineno);
+    count2 = libsa_count (sa, llcp, rlcp, input, len, pattern, plen);
+    ASSERT (count2 == count, "count2 = %zu, lineno = %d\n", count2, lineno);
+}
+
+/* Check the bwt of input built on nthreads threads against the one read
+   from the suffix array and check that libsa_unbwt decodes it.  */
+static void
+testbwt_imp (const char *input, size_t len, int nthreads, int lineno)
+{
+    char *bwt, *expected, *output;
+    int *sa;
+    size_t k, primary, p = 0;
+    int shift = 0, rc;
+    struct libsa_ctx *ctx;
+
+    bwt = alloc (len + 1);
+    expected = alloc (len + 1);
+    output = alloc (len + 1);
+    sa = alloc_init (-1, len);
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_virtual_sentinel (ctx, 1);
+    rc = libsa_ctx_build (ctx, sa, input, len);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    if (len > 0)
+      expected[0] = input[len-1];
+    for (k = 0; k < len; ++k)
+      if (sa[k] == 0)
+        {
+          shift = 1;
+          p = k + 1;
+        }
+      else
+        expected[k+1-shift] = input[sa[k]-1];
+
+    libsa_ctx_set_virtual_sentinel (ctx, 0);
+    libsa_ctx_set_threads (ctx, nthreads);
+    rc = libsa_ctx_bwt (ctx, bwt, &primary, input, len);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    ASSERT (primary == p, "primary = %zu, p = %zu, lineno = %d\n", primary,
+            p, lineno);
+    ASSERT (memcmp (bwt, expected, len) == 0, "lineno = %d\n", lineno);
+    rc = libsa_ctx_unbwt (ctx, output, bwt, len, primary);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    ASSERT (memcmp (output, input, len) == 0, "lineno = %d\n", lineno);
+
+    memset (output, 0, len);
+    rc = libsa_bwt64 (bwt, &primary, input, len);
+    ASSERT (rc == 0 && primary == p, "rc = %d, lineno = %d\n", rc, lineno);
+    rc = libsa_unbwt64 (output, bwt, len, primary);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    ASSERT (memcmp (output, input, len) == 0, "lineno = %d\n", lineno);
+
+    libsa_ctx_destroy (ctx);
+    free (sa);
+    free (output);
+    free (expected);
+    free (bwt);
+}
+
+/* Check the generalized suffix array of the ndocs documents of inputs
+   built on nthreads threads.  Each pair of adjacent suffixes is compared
+   up to the end of their documents.  */
+static void
+testdocs_imp (const char *const *inputs, const size_t *lens, size_t ndocs,
+              int nthreads, int lineno)
+{
+    char *text;
+    int *sa, *docs, *doc, *end, *seen;
+    int64_t *sa64, *docs64;
+    size_t k, d, len = 0;
+    int rc;
+    struct libsa_ctx *ctx;
+
+    for (d = 0; d < ndocs; ++d)
+      len += lens[d];
+    text = alloc (len + 1);
+    sa = alloc_init (-1, len + 1);
+    docs = alloc_init (-1, len + 1);
+    doc = alloc_init (-1, len + 1);
+    end = alloc_init (-1, len + 1);
+    seen = alloc_init (0, len + 1);
+    for (d = 0, len = 0; d < ndocs; ++d)
+      for (k = 0; k < lens[d]; ++k, ++len)
+        {
+          text[len] = inputs[d][k];
+          doc[len] = d;
+          end[len] = len - k + lens[d];
+        }
+
+    ctx = libsa_ctx_create ();
+    libsa_ctx_set_threads (ctx, nthreads);
+    rc = libsa_ctx_build_docs (ctx, sa, docs, inputs, lens, ndocs);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    /* The keys and the lcp array are in the scratch space.  */
+    ASSERT (len == 0 || libsa_ctx_stats (ctx)->peak_scratch
+                        >= 2 * len * sizeof *sa + len,
+            "peak_scratch = %zu, lineno = %d\n",
+            libsa_ctx_stats (ctx)->peak_scratch, lineno);
+    for (k = 0; k < len; ++k)
+      {
+        ASSERT (sa[k] >= 0 && (size_t) sa[k] < len && !seen[sa[k]],
+                "k = %zu, lineno = %d\n", k, lineno);
+        seen[sa[k]] = 1;
+        ASSERT (docs[k] == doc[sa[k]], "k = %zu, lineno = %d\n", k, lineno);
+      }
+    for (k = 1; k < len; ++k)
+      {
+        const int i = sa[k-1], j = sa[k];
+        int t, less;
+
+        for (t = 0; i + t < end[i] && j + t < end[j]
+                    && text[i+t] == text[j+t]; ++t)
+          ;
+        if (i + t < end[i] && j + t < end[j])
+          less = (unsigned char) text[i+t] < (unsigned char) text[j+t];
+        else if (end[i] - i != end[j] - j)
+          less = end[i] - i < end[j] - j;
+        else
+          less = doc[i] < doc[j];
+        ASSERT (less, "k = %zu, lineno = %d\n", k, lineno);
+      }
+
+    sa64 = alloc ((len + 1) * sizeof *sa64);
+    docs64 = alloc ((len + 1) * sizeof *docs64);
+    rc = libsa_build_docs64 (sa64, docs64, inputs, lens, ndocs);
+    ASSERT (rc == 0, "rc = %d, lineno = %d\n", rc, lineno);
+    for (k = 0; k < len; ++k)
+      ASSERT (sa64[k] == sa[k] && docs64[k] == docs[k],
+              "k = %zu, lineno = %d\n", k, lineno);
+
+    libsa_ctx_destroy (ctx);
+    free (docs64);
+    free (sa64);
+    free (seen);
+    free (end);
+    free (doc);
+    free (docs);
+    free (sa);
+    free (text);
+}
+
 static
 int run_test (long test, int argc, char *argv[])
 {
@@ -204,6 +713,1146 @@ int run_test (long test, int argc, char *argv[])
             ASSERT (lcp[5] == 0, "lcp[5] = %d\n", lcp[5]);
             break;
           }
+        case 11:
+          {
+            enum {len = 7919};
+            char input[len];
+            test64_imp ("hello", __LINE__);
+            test64_imp ("abababab", __LINE__);
+            test64_imp ("dabracadabracdabracadabracdabracadabracdabrac", __LINE__);
+            random_string (input, len, 32, 127);
+            test64_imp (input, __LINE__);
+            break;
+          }
+        case 12:
+          {
+            /* Build two suffix arrays in the same workspace.  */
+            const char input[] = "dabracadabracdabracadabracdabracadabrac";
+            const char input2[] = "hello";
+            int sa[sizeof input], sa2[sizeof input];
+            size_t k, wslen;
+            void *ws;
+            int rc;
+
+            wslen = libsa_workspace_size (sizeof input, 256);
+            ws = alloc (wslen);
+            rc = libsa_build_ws (sa, input, sizeof input, ws, 16);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            rc = libsa_build_ws (sa, input, sizeof input, ws, wslen);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            libsa_build (sa2, input, sizeof input);
+            for (k = 0; k < sizeof input; ++k)
+              ASSERT (sa[k] == sa2[k], "sa[%zu] = %d, sa2[%zu] = %d\n",
+                      k, sa[k], k, sa2[k]);
+            rc = libsa_build_ws (sa, input2, sizeof input2, ws, wslen);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (sa[0] == 5, "sa[0] = %d\n", sa[0]);
+            ASSERT (sa[1] == 1, "sa[1] = %d\n", sa[1]);
+            ASSERT (sa[2] == 0, "sa[2] = %d\n", sa[2]);
+            ASSERT (sa[3] == 2, "sa[3] = %d\n", sa[3]);
+            ASSERT (sa[4] == 3, "sa[4] = %d\n", sa[4]);
+            ASSERT (sa[5] == 4, "sa[5] = %d\n", sa[5]);
+            free (ws);
+            break;
+          }
+        case 13:
+          {
+            /* Build several suffix arrays with the same context.  */
+            const char input[] = "dabracadabracdabracadabracdabracadabrac";
+            const char input2[] = "hello";
+            int sa[sizeof input], sa2[sizeof input];
+            int lcp[sizeof input], lcp2[sizeof input];
+            struct libsa_ctx *ctx;
+            const struct libsa_stats *stats;
+            size_t k;
+
+            ctx = libsa_ctx_create ();
+            libsa_ctx_set_log (ctx, 0);
+            libsa_ctx_build (ctx, sa, input2, sizeof input2);
+            stats = libsa_ctx_stats (ctx);
+            ASSERT (stats->depth == 0, "depth = %d\n", stats->depth);
+            libsa_ctx_build (ctx, sa, input, sizeof input);
+            ASSERT (stats->depth > 0, "depth = %d\n", stats->depth);
+            libsa_ctx_build_lcp (ctx, lcp, sa, input, sizeof input);
+            libsa_build (sa2, input, sizeof input);
+            libsa_build_lcp (lcp2, sa2, input, sizeof input);
+            for (k = 0; k < sizeof input; ++k)
+              ASSERT (sa[k] == sa2[k], "sa[%zu] = %d, sa2[%zu] = %d\n",
+                      k, sa[k], k, sa2[k]);
+            for (k = 1; k < sizeof input; ++k)
+              ASSERT (lcp[k] == lcp2[k], "lcp[%zu] = %d, lcp2[%zu] = %d\n",
+                      k, lcp[k], k, lcp2[k]);
+            libsa_ctx_build (ctx, sa, input2, sizeof input2);
+            ASSERT (sa[0] == 5, "sa[0] = %d\n", sa[0]);
+            ASSERT (sa[5] == 4, "sa[5] = %d\n", sa[5]);
+            libsa_ctx_destroy (ctx);
+            break;
+          }
+        case 14:
+          {
+            /* Build on multiple threads.  */
+            enum {len = 300007};
+            char *input;
+            size_t k, run;
+
+            input = alloc (len);
+            random_string (input, len, 'a', 'e');
+            testpar_imp (input, len, 4, __LINE__);
+            random_string (input, len, 1, 255);
+            testpar_imp (input, len, 3, __LINE__);
+            /* Runs of equal characters span the chunks of 5 threads.  */
+            random_string (input, len, 'a', 'c');
+            for (k = 1; k < 5; ++k)
+              {
+                run = 1000 + rand () % 2000;
+                memset (input + k * ((len + 4) / 5) - run / 2,
+                        'a' + rand () % 3, run);
+              }
+            testpar_imp (input, len, 5, __LINE__);
+            /* A run of equal characters spans a whole chunk of 16 threads.  */
+            memset (input + len / 16 - 100, 'b', len / 16 + 300);
+            testpar_imp (input, len, 16, __LINE__);
+            free (input);
+            break;
+          }
+        case 15:
+          {
+            /* Build lcp arrays in place.  */
+            enum {len = 74391};
+            const char *inputs[] = {"hello", "abababab", "aaaa", "a",
+                "dabracadabracdabracadabracdabracadabracdabrac", 0};
+            char *input;
+            int k;
+
+            input = alloc (len);
+            for (k = 0; inputs[k]; ++k)
+              testlowmem_imp (inputs[k], strlen (inputs[k]) + 1, 1, __LINE__);
+            random_string (input, len, 'a', 'd');
+            testlowmem_imp (input, len, 1, __LINE__);
+            testlowmem_imp (input, len, 3, __LINE__);
+            free (input);
+            break;
+          }
+        case 16:
+          {
+            /* Build the suffix array and the lcp array together.  */
+            enum {len = 74391, replen = len};
+            const char *inputs[] = {"", "a", "aa", "aaaa", "hello", "abababab",
+                "mississippi", "aabaabaabaab", "dabracadabrac",
+                "dabracadabracdabracadabracdabracadabracdabracadabracdabrac"
+                "adabracdabracadabracdabracadabracdabracadabrac", 0};
+            char *input;
+            int k;
+
+            input = alloc (len);
+            for (k = 0; inputs[k]; ++k)
+              testsalcp_imp (inputs[k], strlen (inputs[k]) + 1, __LINE__);
+            random_string (input, len, 'a', 'c');
+            testsalcp_imp (input, len, __LINE__);
+            random_string (input, len, 'a', 'e');
+            testsalcp_imp (input, len, __LINE__);
+            random_string (input, len, 1, 255);
+            testsalcp_imp (input, len, __LINE__);
+            /* Long repeats.  */
+            for (k = 0; k < replen - 1; ++k)
+              input[k] = "abcab"[k % 5];
+            input[replen-1] = '\0';
+            testsalcp_imp (input, replen, __LINE__);
+            free (input);
+            break;
+          }
+        case 17:
+          {
+            /* Verify suffix arrays.  */
+            enum {len = 74391, replen = 7919};
+            const char input[] = "dabracadabracdabracadabrac";
+            int sa[sizeof input];
+            int64_t sa64[sizeof input];
+            char *input2;
+            int *sa2, *lcp2;
+            struct libsa_ctx *ctx;
+            size_t k;
+            int rc, tmp;
+
+            libsa_build (sa, input, sizeof input);
+            libsa_build64 (sa64, input, sizeof input);
+            rc = libsa_verify (sa, input, sizeof input);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            rc = libsa_verify64 (sa64, input, sizeof input);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            /* Any input, not only the one terminated by the smallest
+               character.  */
+            rc = libsa_verify (sa, input, sizeof input - 1);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            for (k = 1; k < sizeof input; ++k)
+              {
+                tmp = sa[k-1], sa[k-1] = sa[k], sa[k] = tmp;
+                rc = libsa_verify (sa, input, sizeof input);
+                ASSERT (rc == -1, "rc = %d, k = %zu\n", rc, k);
+                tmp = sa[k-1], sa[k-1] = sa[k], sa[k] = tmp;
+              }
+            tmp = sa[3];
+            sa[3] = sa[4];
+            rc = libsa_verify (sa, input, sizeof input);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            sa[3] = sizeof input;
+            rc = libsa_verify (sa, input, sizeof input);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            sa[3] = tmp;
+
+            input2 = alloc (len);
+            sa2 = alloc_init (-1, len);
+            random_string (input2, len, 'a', 'c');
+            ctx = libsa_ctx_create ();
+            for (k = LIBSA_CHECK_NONE; k <= LIBSA_CHECK_FULL; ++k)
+              {
+                libsa_ctx_set_check (ctx, k);
+                rc = libsa_ctx_build (ctx, sa2, input2, len);
+                ASSERT (rc == 0, "rc = %d, check = %zu\n", rc, k);
+                rc = libsa_ctx_verify (ctx, sa2, input2, len);
+                ASSERT (rc == 0, "rc = %d, check = %zu\n", rc, k);
+              }
+            /* The full checks of every step of a build, on the lcp path and
+               on multiple threads too.  They take quadratic time on
+               repeats, which makes this input short.  */
+            lcp2 = alloc_init (-1, replen);
+            for (k = 0; k < replen - 1; ++k)
+              input2[k] = "abcab"[k % 5];
+            input2[replen-1] = '\0';
+            libsa_ctx_set_check (ctx, LIBSA_CHECK_FULL);
+            rc = libsa_ctx_build_sa_lcp (ctx, sa2, lcp2, input2, replen);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            libsa_ctx_set_threads (ctx, 4);
+            rc = libsa_ctx_build (ctx, sa2, input2, replen);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            libsa_ctx_destroy (ctx);
+            free (lcp2);
+            free (sa2);
+            free (input2);
+            break;
+          }
+        case 18:
+          {
+            /* Collect the statistics of a build.  */
+            const char input[] =
+                "dabracadabracdabracadabracdabracadabracdabracadabracdabrac"
+                "adabracdabracadabracdabracadabracdabracadabrac";
+            int sa[sizeof input], lcp[sizeof input];
+            struct libsa_ctx *ctx;
+            const struct libsa_stats *stats;
+            size_t peak;
+            int k;
+
+            ctx = libsa_ctx_create ();
+            libsa_ctx_set_timing (ctx, 1);
+            libsa_ctx_build (ctx, sa, input, sizeof input);
+            stats = libsa_ctx_stats (ctx);
+            ASSERT (stats->depth > 0, "depth = %d\n", stats->depth);
+            ASSERT (stats->levels[0].len == sizeof input,
+                    "len = %zu\n", stats->levels[0].len);
+            ASSERT (stats->levels[0].abclen == 'r' + 1,
+                    "abclen = %zu\n", stats->levels[0].abclen);
+            for (k = 1; k <= stats->depth; ++k)
+              {
+                ASSERT (stats->levels[k].len == stats->levels[k-1].lmslen,
+                        "k = %d, len = %zu, lmslen = %zu\n",
+                        k, stats->levels[k].len, stats->levels[k-1].lmslen);
+                ASSERT (stats->levels[k].abclen == stats->levels[k-1].redabclen,
+                        "k = %d, abclen = %zu, redabclen = %zu\n",
+                        k, stats->levels[k].abclen, stats->levels[k-1].redabclen);
+              }
+            ASSERT (stats->classify_time >= 0, "classify_time = %f\n",
+                    stats->classify_time);
+            ASSERT (stats->induce_l_time > 0, "induce_l_time = %f\n",
+                    stats->induce_l_time);
+            ASSERT (stats->induce_s_time > 0, "induce_s_time = %f\n",
+                    stats->induce_s_time);
+            ASSERT (stats->lcp_time == 0, "lcp_time = %f\n",
+                    stats->lcp_time);
+            ASSERT (stats->peak_scratch >= sizeof input * sizeof (int),
+                    "peak_scratch = %zu\n", stats->peak_scratch);
+            peak = stats->peak_scratch;
+            libsa_ctx_build_lcp (ctx, lcp, sa, input, sizeof input);
+            ASSERT (stats->depth > 0, "depth = %d\n", stats->depth);
+            ASSERT (stats->lcp_time > 0, "lcp_time = %f\n",
+                    stats->lcp_time);
+            ASSERT (stats->peak_scratch >= peak, "peak_scratch = %zu\n",
+                    stats->peak_scratch);
+            libsa_ctx_set_timing (ctx, 0);
+            libsa_ctx_build (ctx, sa, "hello", sizeof "hello");
+            ASSERT (stats->depth == 0, "depth = %d\n", stats->depth);
+            ASSERT (stats->induce_l_time == 0, "induce_l_time = %f\n",
+                    stats->induce_l_time);
+            ASSERT (stats->lcp_time == 0, "lcp_time = %f\n",
+                    stats->lcp_time);
+            libsa_ctx_destroy (ctx);
+            break;
+          }
+        case 19:
+          {
+            /* Build suffix arrays of uint8_t, uint16_t and uint32_t
+               symbols.  */
+            const char input[] = "dabracadabracdabracadabracdabracadabrac";
+            int sa[sizeof input], sa2[sizeof input], lcp[sizeof input];
+            int64_t sa64[sizeof input];
+            size_t k;
+            int rc;
+
+            libsa_build (sa, input, sizeof input);
+            rc = libsa_build_sym (sa2, lcp, input, 1, sizeof input, 256);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            rc = libsa_build_sym64 (sa64, 0, input, 1, sizeof input, 0);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            for (k = 0; k < sizeof input; ++k)
+              {
+                ASSERT (sa[k] == sa2[k], "sa[%zu] = %d, sa2[%zu] = %d\n",
+                        k, sa[k], k, sa2[k]);
+                ASSERT (sa[k] == sa64[k], "sa[%zu] = %d, sa64[%zu] = %lld\n",
+                        k, sa[k], k, (long long) sa64[k]);
+              }
+            rc = libsa_build_sym (sa2, 0, input, 3, sizeof input, 0);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            rc = libsa_build_sym (sa2, 0, input, 4, 1, (size_t) INT_MAX + 2);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+
+            testsym_imp (2, 2, __LINE__);
+            testsym_imp (1000, 3, __LINE__);
+            testsym_imp (7919, 1000, __LINE__);
+            testsym_imp (74391, 60000, __LINE__);
+            testsym_imp (74391, 1 << 20, __LINE__);
+            break;
+          }
+        case 20:
+          {
+            /* Compact a sparse alphabet.  */
+            enum {len = 7919, nids = 500, abclen = 1 << 20};
+            uint32_t *input, ids[nids];
+            int *sa, *sa2, *lcp, *lcp2;
+            struct libsa_ctx *ctx;
+            const struct libsa_stats *stats;
+            size_t k;
+            int rc;
+
+            input = alloc (len * sizeof *input);
+            sa = alloc_init (-1, len);
+            sa2 = alloc_init (-1, len);
+            lcp = alloc_init (-1, len);
+            lcp2 = alloc_init (-1, len);
+            for (k = 0; k < nids; ++k)
+              ids[k] = 1 + rand () % (abclen - 1);
+            for (k = 0; k < len - 1; ++k)
+              input[k] = ids[rand () % nids];
+            input[len-1] = 0;
+
+            ctx = libsa_ctx_create ();
+            stats = libsa_ctx_stats (ctx);
+            rc = libsa_ctx_build_sym (ctx, sa, lcp, input, sizeof *input, len,
+                                      abclen);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (stats->levels[0].abclen <= nids + 1, "abclen = %zu\n",
+                    stats->levels[0].abclen);
+            libsa_ctx_set_compact (ctx, 0);
+            rc = libsa_ctx_build_sym (ctx, sa2, lcp2, input, sizeof *input, len,
+                                      abclen);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (stats->levels[0].abclen == abclen, "abclen = %zu\n",
+                    stats->levels[0].abclen);
+            ASSERT (memcmp (sa, sa2, len * sizeof *sa) == 0, "\n");
+            ASSERT (memcmp (lcp, lcp2, len * sizeof *lcp) == 0, "\n");
+
+            /* A dense alphabet is not compacted.  */
+            libsa_ctx_set_compact (ctx, 1);
+            for (k = 0; k < len - 1; ++k)
+              input[k] = 1 + k % 999;
+            rc = libsa_ctx_build_sym (ctx, sa, 0, input, sizeof *input, len,
+                                      1000);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (stats->levels[0].abclen == 1000, "abclen = %zu\n",
+                    stats->levels[0].abclen);
+            libsa_ctx_destroy (ctx);
+            free (lcp2);
+            free (lcp);
+            free (sa2);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 21:
+          {
+            /* The workspace of a deep recursion is that of its largest
+               level, rather than the sum of all levels.  */
+            enum {len = 20000};
+            char *input;
+            int *sa;
+            struct libsa_ctx *ctx;
+            const struct libsa_stats *stats;
+            size_t k, n;
+            int rc;
+
+            input = alloc (len);
+            sa = alloc_init (-1, len);
+            /* The fibonacci string, which is the fixed point of a -> ab,
+               b -> a.  */
+            input[0] = 'b';
+            for (k = 0, n = 1; n < len - 1; ++k)
+              {
+                input[n++] = 'b';
+                if (input[k] == 'b' && n < len - 1)
+                  input[n++] = 'c';
+              }
+            input[len-1] = 'a';
+            ctx = libsa_ctx_create ();
+            stats = libsa_ctx_stats (ctx);
+            rc = libsa_ctx_build (ctx, sa, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (stats->depth >= 5, "depth = %d\n", stats->depth);
+            ASSERT (stats->peak_scratch <= libsa_workspace_size (len, 'c' + 1),
+                    "peak_scratch = %zu\n", stats->peak_scratch);
+            ASSERT (stats->peak_scratch < 5 * len,
+                    "peak_scratch = %zu\n", stats->peak_scratch);
+            libsa_ctx_destroy (ctx);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 22:
+          {
+            /* Build with a virtual sentinel.  */
+            enum {len = 300007};
+            char *input;
+            uint16_t input16[] = {3, 0, 2, 0, 3, 0, 2, 0, 3};
+            enum {len16 = sizeof input16 / sizeof *input16};
+            int sa[len16];
+            struct libsa_ctx *ctx;
+            size_t k;
+            int rc;
+
+            testvirt_imp ("a", 1, 1, __LINE__);
+            testvirt_imp ("banana", 6, 1, __LINE__);
+            testvirt_imp ("aaaaaaa", 7, 1, __LINE__);
+            testvirt_imp ("abababab", 8, 1, __LINE__);
+            testvirt_imp ("dcba", 4, 1, __LINE__);
+            testvirt_imp ("mississippi", 11, 1, __LINE__);
+            testvirt_imp ("\0\0\0\0\0", 5, 1, __LINE__);
+            testvirt_imp ("a\0b\0a\0b\0a", 9, 1, __LINE__);
+
+            input = alloc (len);
+            random_string (input, 1000, 0, 3);
+            input[999] = 2;
+            testvirt_imp (input, 1000, 1, __LINE__);
+            random_string (input, 1000, 0, 255);
+            input[999] = 'z';
+            testvirt_imp (input, 1000, 1, __LINE__);
+            for (k = 0; k < 1000; ++k)
+              input[k] = "abaabab"[k % 7];
+            testvirt_imp (input, 1000, 1, __LINE__);
+            random_string (input, len, 0, 3);
+            input[len-1] = 1;
+            testvirt_imp (input, len, 1, __LINE__);
+            testvirt_imp (input, len, 4, __LINE__);
+            free (input);
+
+            ctx = libsa_ctx_create ();
+            libsa_ctx_set_virtual_sentinel (ctx, 1);
+            rc = libsa_ctx_build_sym (ctx, sa, 0, input16, sizeof *input16,
+                                      len16, 0);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            {
+              const int expected[] = {5, 1, 7, 3, 6, 2, 8, 4, 0};
+              ASSERT (memcmp (sa, expected, sizeof sa) == 0, "\n");
+            }
+            libsa_ctx_destroy (ctx);
+            break;
+          }
+        case 23:
+          {
+            /* Build from a file to a file.  */
+            enum {len = 100003};
+            char *input;
+            char sa_path[32];
+            int rc;
+
+            testfile_imp ("", 0, __LINE__);
+            testfile_imp ("a", 1, __LINE__);
+            testfile_imp ("banana", 6, __LINE__);
+            testfile_imp ("mississippi", 11, __LINE__);
+            input = alloc (len);
+            random_string (input, len, 0, 255);
+            testfile_imp (input, len, __LINE__);
+            random_string (input, len, 'a', 'c');
+            testfile_imp (input, len, __LINE__);
+            free (input);
+
+            temp_file (sa_path, __LINE__);
+            errno = 0;
+            rc = libsa_build_file ("/nonexistent/libsa.t", sa_path, 0);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            ASSERT (errno == ENOENT, "errno = %d\n", errno);
+            remove (sa_path);
+            break;
+          }
+        case 24:
+          {
+            /* Back the scratch space by a temporary file.  */
+            enum {len = 200003};
+            char *input, inpath[32], sapath[32];
+            int *sa, *lcp, *sa2, *lcp2;
+            struct libsa_ctx *ctx;
+            FILE *f;
+            int rc;
+
+            input = alloc (len);
+            random_string (input, len, 'a', 'e');
+            sa = alloc_init (-1, len);
+            lcp = alloc_init (-1, len);
+            sa2 = alloc_init (-1, len);
+            lcp2 = alloc_init (-1, len);
+            rc = libsa_build_sa_lcp (sa, lcp, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+
+            ctx = libsa_ctx_create ();
+            libsa_ctx_set_scratch_dir (ctx, "/tmp", 0);
+            rc = libsa_ctx_build_sa_lcp (ctx, sa2, lcp2, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (memcmp (sa, sa2, len * sizeof *sa) == 0, "\n");
+            ASSERT (memcmp (lcp + 1, lcp2 + 1, (len - 1) * sizeof *lcp) == 0,
+                    "\n");
+            memset (lcp2, -1, len * sizeof *lcp2);
+            rc = libsa_ctx_build_lcp (ctx, lcp2, sa, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (memcmp (lcp + 1, lcp2 + 1, (len - 1) * sizeof *lcp) == 0,
+                    "\n");
+
+            /* A budget larger than the scratch space keeps it in memory.  */
+            libsa_ctx_set_scratch_dir (ctx, "/nonexistent/libsa.t", 1 << 30);
+            memset (sa2, -1, len * sizeof *sa2);
+            rc = libsa_ctx_build (ctx, sa2, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (memcmp (sa, sa2, len * sizeof *sa) == 0, "\n");
+            libsa_ctx_destroy (ctx);
+
+            /* A workspace that cannot be mapped fails the build.  */
+            ctx = libsa_ctx_create ();
+            libsa_ctx_set_scratch_dir (ctx, "/nonexistent/libsa.t", 0);
+            errno = 0;
+            rc = libsa_ctx_build (ctx, sa2, input, len);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            ASSERT (errno == ENOENT, "errno = %d\n", errno);
+            /* A file build reports the errno of the scratch space too.  */
+            temp_file (inpath, __LINE__);
+            temp_file (sapath, __LINE__);
+            f = fopen (inpath, "wb");
+            ASSERT (f && fwrite (input, 1, len, f) == len, "\n");
+            fclose (f);
+            errno = 0;
+            rc = libsa_ctx_build_file (ctx, inpath, sapath, 0);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            ASSERT (errno == ENOENT, "errno = %d\n", errno);
+            remove (sapath);
+            remove (inpath);
+            libsa_ctx_destroy (ctx);
+
+            free (lcp2);
+            free (sa2);
+            free (lcp);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 25:
+          {
+            /* Save and open an index file.  */
+            enum {len = 100003};
+            char *input;
+            char path[32];
+            int *sa, *lcp;
+            int64_t *sa64;
+            struct libsa_index *index;
+            const int *isa;
+            size_t size;
+            FILE *f;
+            int rc;
+
+            input = alloc (len);
+            random_string (input, len, 'a', 'z');
+            sa = alloc_init (-1, len);
+            lcp = alloc_init (-1, len);
+            sa64 = alloc (len * sizeof *sa64);
+            rc = libsa_build_sa_lcp (sa, lcp, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            temp_file (path, __LINE__);
+
+            rc = libsa_index_save (path, input, len, sa, lcp);
+            ASSERT (rc == 0, "rc = %d, errno = %d\n", rc, errno);
+            index = libsa_index_open (path);
+            ASSERT (index, "errno = %d\n", errno);
+            ASSERT (libsa_index_len (index) == len, "\n");
+            isa = libsa_index_sa (index);
+            ASSERT (isa && (size_t) isa % 4096 == 0, "\n");
+            ASSERT (memcmp (isa, sa, len * sizeof *sa) == 0, "\n");
+            ASSERT (memcmp (libsa_index_lcp (index), lcp, len * sizeof *lcp)
+                    == 0, "\n");
+            ASSERT (libsa_index_section (index, LIBSA_SECTION_LCP, &size)
+                    && size == len * sizeof *lcp, "size = %zu\n", size);
+            ASSERT (libsa_index_sa64 (index) == 0, "\n");
+            rc = libsa_index_check (index, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            rc = libsa_index_check (index, input, len - 1);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            ++input[len/2];
+            rc = libsa_index_check (index, input, len);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+            --input[len/2];
+            libsa_index_close (index);
+
+            /* An index of int64_t without the lcp array.  */
+            rc = libsa_build64 (sa64, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            rc = libsa_index_save64 (path, input, len, sa64, 0);
+            ASSERT (rc == 0, "rc = %d, errno = %d\n", rc, errno);
+            index = libsa_index_open (path);
+            ASSERT (index, "errno = %d\n", errno);
+            ASSERT (libsa_index_sa (index) == 0, "\n");
+            ASSERT (libsa_index_lcp64 (index) == 0, "\n");
+            ASSERT (memcmp (libsa_index_sa64 (index), sa64,
+                            len * sizeof *sa64) == 0, "\n");
+            libsa_index_close (index);
+
+            /* Auxiliary sections.  */
+            {
+                static const char note[] = "auxiliary";
+                int *isa0 = alloc (len * sizeof *isa0);
+                int *llcp = alloc (len * sizeof *llcp);
+                int *rlcp = alloc (len * sizeof *rlcp);
+                struct libsa_section_data sec[] = {
+                    {LIBSA_SECTION_SA, 0, len * sizeof *sa},
+                    {LIBSA_SECTION_ISA, 0, len * sizeof *isa0},
+                    {LIBSA_SECTION_LLCP, 0, len * sizeof *llcp},
+                    {LIBSA_SECTION_RLCP, 0, len * sizeof *rlcp},
+                    {LIBSA_SECTION_USER + 1, note, sizeof note},
+                };
+                const void *p;
+                size_t k;
+                uint64_t bad;
+
+                sec[0].data = sa;
+                sec[1].data = isa0;
+                sec[2].data = llcp;
+                sec[3].data = rlcp;
+                for (k = 0; k < len; ++k)
+                  isa0[sa[k]] = k;
+                rc = libsa_build_lcplr (llcp, rlcp, lcp, len);
+                ASSERT (rc == 0, "rc = %d\n", rc);
+                rc = libsa_index_save_sections (path, input, len, sizeof *sa,
+                                                sec, 5);
+                ASSERT (rc == 0, "rc = %d, errno = %d\n", rc, errno);
+                index = libsa_index_open (path);
+                ASSERT (index, "errno = %d\n", errno);
+                ASSERT (memcmp (libsa_index_sa (index), sa, len * sizeof *sa)
+                        == 0, "\n");
+                ASSERT (libsa_index_lcp (index) == 0, "\n");
+                p = libsa_index_section (index, LIBSA_SECTION_ISA, &size);
+                ASSERT (p && (size_t) p % 4096 == 0
+                        && size == len * sizeof *isa0
+                        && memcmp (p, isa0, size) == 0, "size = %zu\n", size);
+                p = libsa_index_section (index, LIBSA_SECTION_LLCP, &size);
+                ASSERT (p && memcmp (p, llcp, len * sizeof *llcp) == 0, "\n");
+                p = libsa_index_section (index, LIBSA_SECTION_RLCP, &size);
+                ASSERT (p && memcmp (p, rlcp, len * sizeof *rlcp) == 0, "\n");
+                p = libsa_index_section (index, LIBSA_SECTION_USER + 1, &size);
+                ASSERT (p && size == sizeof note && memcmp (p, note, size) == 0,
+                        "size = %zu\n", size);
+                ASSERT (libsa_index_section (index, LIBSA_SECTION_USER, 0)
+                        == 0, "\n");
+                libsa_index_close (index);
+
+                /* An isa section one element short, as the header of the
+                   second section says.  */
+                f = fopen (path, "r+b");
+                ASSERT (f, "errno = %d\n", errno);
+                bad = (len - 1) * sizeof *isa0;
+                fseek (f, 40 + 24 + 16, SEEK_SET);
+                fwrite (&bad, sizeof bad, 1, f);
+                fclose (f);
+                errno = 0;
+                index = libsa_index_open (path);
+                ASSERT (index == 0 && errno == EINVAL, "errno = %d\n", errno);
+
+                /* Sections that cannot be saved.  */
+                sec[1].size -= sizeof *isa0;
+                errno = 0;
+                rc = libsa_index_save_sections (path, input, len, sizeof *sa,
+                                                sec, 5);
+                ASSERT (rc == -1 && errno == EINVAL, "errno = %d\n", errno);
+                sec[1].size += sizeof *isa0;
+                sec[2].id = LIBSA_SECTION_ISA;
+                errno = 0;
+                rc = libsa_index_save_sections (path, input, len, sizeof *sa,
+                                                sec, 5);
+                ASSERT (rc == -1 && errno == EINVAL, "errno = %d\n", errno);
+                errno = 0;
+                rc = libsa_index_save_sections (path, input, len, 3, sec, 1);
+                ASSERT (rc == -1 && errno == EINVAL, "errno = %d\n", errno);
+
+                free (rlcp);
+                free (llcp);
+                free (isa0);
+            }
+
+            /* Not an index file.  */
+            f = fopen (path, "wb");
+            ASSERT (f, "errno = %d\n", errno);
+            fwrite (input, 1, len, f);
+            fclose (f);
+            errno = 0;
+            index = libsa_index_open (path);
+            ASSERT (index == 0 && errno == EINVAL, "errno = %d\n", errno);
+            remove (path);
+            errno = 0;
+            index = libsa_index_open (path);
+            ASSERT (index == 0 && errno == ENOENT, "errno = %d\n", errno);
+
+            free (sa64);
+            free (lcp);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 26:
+          {
+            /* Search patterns.  */
+            enum {len = 100003};
+            static const char *patterns[] = {"", "a", "ab", "abc", "ba",
+                                             "zz", "aaaa", "abababab", "\0"};
+            char *input, pattern[64];
+            int *sa, *lcp, *llcp, *rlcp;
+            size_t k, j, pos, plen;
+            int rc;
+
+            input = alloc (len);
+            sa = alloc_init (-1, len);
+            lcp = alloc_init (-1, len);
+            llcp = alloc_init (-1, len);
+            rlcp = alloc_init (-1, len);
+            for (j = 0; j < 2; ++j)
+              {
+                if (j == 0)
+                  random_string (input, len, 'a', 'd');
+                else
+                  for (k = 0; k < len; ++k)
+                    input[k] = "ab"[k % 7 == 6];
+                input[len-1] = '\0';
+                rc = libsa_build_sa_lcp (sa, lcp, input, len);
+                ASSERT (rc == 0, "rc = %d\n", rc);
+                rc = libsa_build_lcplr (llcp, rlcp, lcp, len);
+                ASSERT (rc == 0, "rc = %d\n", rc);
+                for (k = 0; k < sizeof patterns / sizeof *patterns; ++k)
+                  testlocate_imp (sa, llcp, rlcp, input, len, patterns[k],
+                                  strlen (patterns[k]) + (k == 8), __LINE__);
+                for (k = 0; k < 300; ++k)
+                  {
+                    /* Substrings of input, some of which are then changed
+                       to miss.  */
+                    plen = 1 + rand () % (sizeof pattern - 1);
+                    pos = rand () % (len - plen);
+                    memcpy (pattern, input + pos, plen);
+                    if (k % 3 == 0)
+                      pattern[rand () % plen] = 'a' + rand () % 4;
+                    testlocate_imp (sa, llcp, rlcp, input, len, pattern, plen,
+                                    __LINE__);
+                  }
+                /* The last suffix.  */
+                testlocate_imp (sa, llcp, rlcp, input, len,
+                                input + len - 3, 3, __LINE__);
+              }
+            free (rlcp);
+            free (llcp);
+            free (lcp);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 27:
+          {
+            /* Search a batch of patterns.  */
+            enum {len = 100003, npatterns = 3001, maxplen = 40};
+            char *input, *buf;
+            const char **patterns;
+            size_t *plens, *first, *count;
+            int *sa;
+            struct libsa_ctx *ctx;
+            size_t k, pos, f, n;
+            int rc, nthreads;
+
+            input = alloc (len);
+            random_string (input, len, 'a', 'd');
+            sa = alloc_init (-1, len);
+            rc = libsa_build (sa, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            buf = alloc (npatterns * maxplen);
+            patterns = alloc (npatterns * sizeof *patterns);
+            plens = alloc (npatterns * sizeof *plens);
+            first = alloc (npatterns * sizeof *first);
+            count = alloc (npatterns * sizeof *count);
+            for (k = 0; k < npatterns; ++k)
+              {
+                char *p = buf + k * maxplen;
+
+                plens[k] = rand () % maxplen;
+                pos = rand () % (len - plens[k]);
+                memcpy (p, input + pos, plens[k]);
+                if (k % 3 == 0 && plens[k] > 0)
+                  p[rand () % plens[k]] = 'a' + rand () % 4;
+                if (k % 10 == 9)
+                  /* The same pattern as the previous one.  */
+                  memcpy (p, p - maxplen, plens[k] = plens[k-1]);
+                patterns[k] = p;
+              }
+            /* The last suffix and a suffix of the last suffix.  */
+            patterns[0] = input + len - 5;
+            plens[0] = 5;
+            patterns[1] = input + len - 5;
+            plens[1] = 3;
+
+            for (nthreads = 1; nthreads <= 4; nthreads += 3)
+              {
+                ctx = libsa_ctx_create ();
+                libsa_ctx_set_threads (ctx, nthreads);
+                memset (first, -1, npatterns * sizeof *first);
+                rc = libsa_ctx_locate_batch (ctx, first, count, sa, input, len,
+                                             patterns, plens, npatterns);
+                ASSERT (rc == 0, "rc = %d\n", rc);
+                for (k = 0; k < npatterns; ++k)
+                  {
+                    n = libsa_locate (&f, sa, 0, 0, input, len, patterns[k],
+                                      plens[k]);
+                    ASSERT (count[k] == n && first[k] == f,
+                            "k = %zu, count = %zu, n = %zu, first = %zu, "
+                            "f = %zu\n", k, count[k], n, first[k], f);
+                  }
+                libsa_ctx_destroy (ctx);
+              }
+            memset (count, -1, npatterns * sizeof *count);
+            rc = libsa_locate_batch (0, count, sa, input, len, patterns, plens,
+                                     npatterns);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            for (k = 0; k < npatterns; ++k)
+              ASSERT (count[k] == libsa_count (sa, 0, 0, input, len,
+                                               patterns[k], plens[k]),
+                      "k = %zu\n", k);
+
+            free (count);
+            free (first);
+            free (plens);
+            free (patterns);
+            free (buf);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 28:
+          {
+            /* The bwt and its inverse.  */
+            enum {len = 200003};
+            char *input, bwt[6], output[6];
+            size_t k, primary;
+            int rc;
+
+            testbwt_imp ("", 0, 1, __LINE__);
+            testbwt_imp ("a", 1, 1, __LINE__);
+            testbwt_imp ("ba", 2, 1, __LINE__);
+            testbwt_imp ("banana", 6, 1, __LINE__);
+            testbwt_imp ("mississippi", 11, 1, __LINE__);
+            testbwt_imp ("aaaaaaa", 7, 1, __LINE__);
+            testbwt_imp ("\0\0\0\0", 4, 1, __LINE__);
+
+            /* The bwt of banana$ is annb$aa.  */
+            rc = libsa_bwt (bwt, &primary, "banana", 6);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            ASSERT (memcmp (bwt, "annbaa", 6) == 0 && primary == 4,
+                    "primary = %zu\n", primary);
+            rc = libsa_unbwt (output, "annbaa", 6, 4);
+            ASSERT (rc == 0 && memcmp (output, "banana", 6) == 0, "\n");
+            rc = libsa_unbwt (output, "annbaa", 6, 7);
+            ASSERT (rc == -1, "rc = %d\n", rc);
+
+            input = alloc (len);
+            random_string (input, len, 0, 255);
+            testbwt_imp (input, len, 1, __LINE__);
+            testbwt_imp (input, len, 4, __LINE__);
+            random_string (input, len, 'a', 'c');
+            testbwt_imp (input, len, 4, __LINE__);
+            /* The full checks are quadratic on a periodic input.  */
+            for (k = 0; k < 5000; ++k)
+              input[k] = "abaababa"[k % 8];
+            testbwt_imp (input, 5000, 1, __LINE__);
+            free (input);
+            break;
+          }
+        case 29:
+          {
+            /* An FM-index.  */
+            enum {len = 100003};
+            static const size_t rates[] = {1, 4, 32};
+            char *input, pattern[16];
+            int *sa;
+            struct libsa_ctx *ctx;
+            struct libsa_fm *fm;
+            size_t k, j, r, plen, pos, first, n, f;
+            int rc;
+
+            input = alloc (len);
+            sa = alloc_init (-1, len);
+            ctx = libsa_ctx_create ();
+            libsa_ctx_set_virtual_sentinel (ctx, 1);
+            for (j = 0; j < 2; ++j)
+              {
+                if (j == 0)
+                  random_string (input, len, 0, 255);
+                else
+                  random_string (input, len, 'a', 'c');
+                rc = libsa_ctx_build (ctx, sa, input, len);
+                ASSERT (rc == 0, "rc = %d\n", rc);
+                for (r = 0; r < sizeof rates / sizeof *rates; ++r)
+                  {
+                    fm = libsa_fm_build (input, len, rates[r]);
+                    ASSERT (fm, "\n");
+                    ASSERT (libsa_fm_size (fm) < 2 * len + 8 * len / rates[r]
+                            + 4096, "size = %zu\n", libsa_fm_size (fm));
+                    for (k = 0; k < len; k += 1 + rand () % 97)
+                      ASSERT (libsa_fm_sa (fm, k) == (size_t) sa[k],
+                              "k = %zu, rate = %zu\n", k, rates[r]);
+                    ASSERT (libsa_fm_sa (fm, len - 1) == (size_t) sa[len-1],
+                            "\n");
+                    n = libsa_fm_count (fm, &first, "", 0);
+                    ASSERT (n == len && first == 0, "n = %zu\n", n);
+                    for (k = 0; k < 300; ++k)
+                      {
+                        plen = 1 + rand () % (sizeof pattern);
+                        pos = rand () % (len - plen);
+                        memcpy (pattern, input + pos, plen);
+                        if (k % 3 == 0)
+                          pattern[rand () % plen] = 'a' + rand () % 3;
+                        n = libsa_fm_count (fm, &first, pattern, plen);
+                        ASSERT (n == libsa_locate (&f, sa, 0, 0, input, len,
+                                                   pattern, plen),
+                                "n = %zu, k = %zu\n", n, k);
+                        ASSERT (n == 0 || first == f, "first = %zu, f = %zu\n",
+                                first, f);
+                      }
+                    libsa_fm_destroy (fm);
+                  }
+              }
+            libsa_ctx_destroy (ctx);
+
+            fm = libsa_fm_build ("banana", 6, 2);
+            ASSERT (libsa_fm_count (fm, &first, "ana", 3) == 2 && first == 1,
+                    "first = %zu\n", first);
+            ASSERT (libsa_fm_count (fm, 0, "nab", 3) == 0, "\n");
+            for (k = 0; k < 6; ++k)
+              ASSERT (libsa_fm_sa (fm, k) == (size_t) "531042"[k] - '0',
+                      "k = %zu\n", k);
+            libsa_fm_destroy (fm);
+            ASSERT (libsa_fm_build ("banana", 6, 0) == 0, "\n");
+
+            free (sa);
+            free (input);
+            break;
+          }
+        case 30:
+          {
+            /* Sample the suffix array and the inverse suffix array.  */
+            enum {len = 50021};
+            static const size_t rates[] = {1, 3, 8, 32};
+            char *input;
+            int *sa, *isa;
+            struct libsa_ctx *ctx;
+            struct libsa_fm *fm;
+            size_t k, r, size[2];
+            int rc, sampling;
+
+            input = alloc (len);
+            sa = alloc_init (-1, len);
+            isa = alloc_init (-1, len);
+            random_string (input, len, 'a', 'e');
+            rc = libsa_build (sa, input, len);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            for (k = 0; k < len; ++k)
+              isa[sa[k]] = k;
+            ctx = libsa_ctx_create ();
+            for (r = 0; r < sizeof rates / sizeof *rates; ++r)
+              for (sampling = LIBSA_SAMPLE_TEXT; sampling <= LIBSA_SAMPLE_RANK;
+                   ++sampling)
+                {
+                  libsa_ctx_set_sampling (ctx, sampling);
+                  fm = libsa_ctx_fm_build (ctx, input, len, rates[r]);
+                  ASSERT (fm, "\n");
+                  /* The bwt and the suffix array are in the scratch
+                     space.  */
+                  ASSERT (libsa_ctx_stats (ctx)->peak_scratch
+                          >= len * sizeof *sa + len + 1,
+                          "peak_scratch = %zu\n",
+                          libsa_ctx_stats (ctx)->peak_scratch);
+                  for (k = 0; k < len; ++k)
+                    {
+                      ASSERT (libsa_fm_sa (fm, k) == (size_t) sa[k],
+                              "k = %zu, rate = %zu, sampling = %d\n", k,
+                              rates[r], sampling);
+                      ASSERT (libsa_fm_isa (fm, k) == (size_t) isa[k],
+                              "k = %zu, rate = %zu, sampling = %d\n", k,
+                              rates[r], sampling);
+                    }
+                  size[sampling] = libsa_fm_size (fm);
+                  libsa_fm_destroy (fm);
+                }
+            /* Rank sampling does without the bitvector of sampled rows.  */
+            ASSERT (size[LIBSA_SAMPLE_RANK] < size[LIBSA_SAMPLE_TEXT],
+                    "size = %zu, %zu\n", size[0], size[1]);
+            libsa_ctx_destroy (ctx);
+            free (isa);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 31:
+          {
+            /* The longest common extension of two suffixes.  */
+            enum {len = 300007};
+            char *input;
+            int *sa, *lcp, *isa, m, zero = 0;
+            int64_t sa64[12], lcp64[12];
+            struct libsa_lce *lce;
+            struct libsa_lce64 *lce64;
+            size_t k, j, x, y, i, n;
+            int rc;
+
+            input = alloc (len);
+            sa = alloc_init (-1, len);
+            lcp = alloc_init (-1, len);
+            isa = alloc_init (-1, len);
+            for (j = 0; j < 2; ++j)
+              {
+                /* The full checks are quadratic on a periodic input.  */
+                const size_t size = j == 0 ? len : 20011;
+
+                if (j == 0)
+                  random_string (input, size, 'a', 'c');
+                else
+                  {
+                    /* Long extensions.  */
+                    for (k = 0; k < size; ++k)
+                      input[k] = "abaababa"[k % 8] + (k == size / 2);
+                    input[size-1] = '\0';
+                  }
+                rc = libsa_build_sa_lcp (sa, lcp, input, size);
+                ASSERT (rc == 0, "rc = %d\n", rc);
+                for (k = 0; k < size; ++k)
+                  isa[sa[k]] = k;
+                /* lcp[0] is not part of any query.  */
+                lcp[0] = -1;
+                lce = libsa_lce_build (sa, lcp, j ? isa : 0, size);
+                ASSERT (lce, "\n");
+                for (k = 0; k < 3000; ++k)
+                  {
+                    x = 1 + rand () % (size - 1);
+                    y = k % 2 ? x + rand () % 300 : x + rand () % (size - x);
+                    if (y >= size)
+                      y = size - 1;
+                    for (m = lcp[x], i = x + 1; i <= y; ++i)
+                      if (lcp[i] < m)
+                        m = lcp[i];
+                    ASSERT (libsa_lce_rmq (lce, x, y) == m,
+                            "x = %zu, y = %zu, m = %d\n", x, y, m);
+                  }
+                for (k = 0; k < 20000; ++k)
+                  {
+                    x = rand () % size;
+                    y = k % 4 ? (size_t) rand () % size
+                              : (x + 8 * (rand () % 16)) % size;
+                    for (n = 0; x + n < size && y + n < size
+                                && input[x+n] == input[y+n]; ++n)
+                      ;
+                    ASSERT (libsa_lce (lce, x, y) == n,
+                            "x = %zu, y = %zu, n = %zu\n", x, y, n);
+                  }
+                libsa_lce_destroy (lce);
+              }
+
+            rc = libsa_build_sa_lcp64 (sa64, lcp64, "mississippi", 12);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            lce64 = libsa_lce_build64 (sa64, lcp64, 0, 12);
+            ASSERT (libsa_lce64 (lce64, 1, 4) == 4, "\n");
+            ASSERT (libsa_lce64 (lce64, 2, 5) == 3, "\n");
+            ASSERT (libsa_lce64 (lce64, 0, 7) == 0, "\n");
+            ASSERT (libsa_lce64 (lce64, 7, 7) == 5, "\n");
+            ASSERT (libsa_lce_rmq64 (lce64, 1, 11) == 0, "\n");
+            libsa_lce_destroy64 (lce64);
+            lce = libsa_lce_build (&zero, &zero, 0, 1);
+            ASSERT (libsa_lce (lce, 0, 0) == 1, "\n");
+            libsa_lce_destroy (lce);
+
+            free (isa);
+            free (lcp);
+            free (sa);
+            free (input);
+            break;
+          }
+        case 32:
+          {
+            /* A generalized suffix array of many documents.  */
+            enum {ndocs = 3000};
+            static const char *const small[] = {"banana", "ana", "", "an",
+                                                "banana", "a"};
+            static const size_t smalllens[] = {6, 3, 0, 2, 6, 1};
+            static const int firstsa[] = {5, 8, 16, 17};
+            static const int firstdocs[] = {0, 1, 4, 5};
+            const char **inputs;
+            char *buf;
+            size_t *lens, d, k;
+            int sa[18], docs[18], rc;
+
+            testdocs_imp (small, smalllens, 6, 1, __LINE__);
+            testdocs_imp (small, smalllens, 1, 1, __LINE__);
+            testdocs_imp (small, smalllens, 0, 1, __LINE__);
+            /* The suffixes a of documents 0, 1, 4 and 5 come first, in the
+               order of the documents.  */
+            rc = libsa_build_docs (sa, docs, small, smalllens, 6);
+            ASSERT (rc == 0, "rc = %d\n", rc);
+            for (k = 0; k < 4; ++k)
+              ASSERT (sa[k] == firstsa[k] && docs[k] == firstdocs[k],
+                      "k = %zu, sa[k] = %d\n", k, sa[k]);
+
+            inputs = alloc (ndocs * sizeof *inputs);
+            lens = alloc (ndocs * sizeof *lens);
+            buf = alloc (ndocs * 24);
+            for (k = 0; k < 3; ++k)
+              {
+                /* The documents of the second round hold bytes 0 to 2.  The
+                   documents of the third round are all equal.  */
+                const int min = k == 1 ? 0 : 'a';
+
+                random_string (buf, ndocs * 24, min, min + 3);
+                for (d = 0; d < ndocs; ++d)
+                  {
+                    inputs[d] = buf + d * 24;
+                    lens[d] = k == 2 ? 2 : (size_t) rand () % 24;
+                    if (k == 2)
+                      inputs[d] = "ab";
+                    /* Repeat some of the documents.  */
+                    else if (d > 0 && rand () % 4 == 0)
+                      {
+                        inputs[d] = inputs[d-1];
+                        lens[d] = lens[d-1];
+                      }
+                  }
+                testdocs_imp (inputs, lens, ndocs, 1, __LINE__);
+                testdocs_imp (inputs, lens, ndocs, 4, __LINE__);
+              }
+            free (buf);
+            free (lens);
+            free (inputs);
+            break;
+          }
         case 97:
           {
             enum {len = 74391};